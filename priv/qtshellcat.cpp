@@ -0,0 +1,181 @@
+#include <QtCore>
+#include "qtshell.h"
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+class QtShell::MappedFile::Data {
+public:
+    Data() : data(0), size(0) {
+    }
+
+    QFile file;
+    uchar* data;
+    qint64 size;
+};
+
+// Open a file for cat. It returns false with a warning if the file could not be read
+static bool openFile(const QString& file, QFile& f, QIODevice::OpenMode mode = QIODevice::ReadOnly) {
+    QString path = QtShell::realpath_strip(file);
+
+    QFileInfo info(path);
+
+    if (!info.exists()) {
+        qWarning() << QString("cat: %1: No such file or directory").arg(file);
+        return false;
+    }
+
+    f.setFileName(path);
+    if (!f.open(mode)) {
+        qWarning() << QString("cat: %1: %2").arg(f.errorString()).arg(file);
+        return false;
+    }
+
+    return true;
+}
+
+QtShell::MappedFile::MappedFile(const QString &file) : d(new Data())
+{
+    if (!openFile(file, d->file)) {
+        return;
+    }
+
+    d->size = d->file.size();
+
+    // An empty file could not be mapped. A compressed resource could not be mapped too, then bytes() reads it
+    if (d->size > 0) {
+        d->data = d->file.map(0, d->size);
+    }
+}
+
+QtShell::MappedFile::~MappedFile()
+{
+    if (d->data) {
+        d->file.unmap(d->data);
+    }
+    delete d;
+}
+
+bool QtShell::MappedFile::isValid() const
+{
+    return d->file.isOpen();
+}
+
+qint64 QtShell::MappedFile::size() const
+{
+    return d->size;
+}
+
+const char *QtShell::MappedFile::constData() const
+{
+    return reinterpret_cast<const char*>(d->data);
+}
+
+QByteArray QtShell::MappedFile::bytes() const
+{
+    if (!d->data) {
+        if (!d->file.isOpen() || !d->file.seek(0)) {
+            return QByteArray();
+        }
+        return d->file.readAll();
+    }
+
+    // QByteArray is limited to 2GB. Use constData() and size() instead
+    if (d->size > INT_MAX) {
+        return QByteArray();
+    }
+
+    return QByteArray::fromRawData(constData(), (int) d->size);
+}
+
+QByteArray QtShell::catBytes(const QString &file)
+{
+    QFile f;
+    if (!openFile(file, f)) {
+        return QByteArray();
+    }
+
+    return f.readAll();
+}
+
+QString QtShell::cat(const QString &file)
+{
+    // Not mapped: a file truncated by another process while mapped would raise SIGBUS, and read() is faster for small files
+    return catBytes(file);
+}
+
+QString QtShell::cat(const QStringList &files)
+{
+    QString content;
+
+    for (int i = 0 ; i < files.size() ; i++) {
+        if (i != 0) {
+            content = content + "\n";
+        }
+        content = content + cat(files[i]);
+    }
+
+    return content;
+}
+
+bool QtShell::cat(const QString &file, const CatCallback &callback, int bufferSize, bool sequential)
+{
+    QFile f;
+    // QFile's own buffer would add a copy of every chunk
+    if (!openFile(file, f, QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        return false;
+    }
+
+#ifdef Q_OS_LINUX
+    if (sequential && f.handle() >= 0) {
+        // Read ahead more aggressively
+        posix_fadvise(f.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+#else
+    Q_UNUSED(sequential);
+#endif
+
+    QByteArray buffer(qMax(bufferSize, 1), Qt::Uninitialized);
+
+    forever {
+        qint64 size = f.read(buffer.data(), buffer.size());
+
+        if (size < 0) {
+            qWarning() << QString("cat: %1: %2").arg(file).arg(f.errorString());
+            return false;
+        }
+
+        if (size == 0) {
+            break;
+        }
+
+        // The chunk references the buffer, which is reused by the next read
+        if (!callback(QByteArray::fromRawData(buffer.constData(), (int) size))) {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool QtShell::cat(const QString &file, QIODevice *sink, int bufferSize, bool sequential)
+{
+    if (!sink || !sink->isWritable()) {
+        qWarning() << QString("cat: %1: The sink is not writable").arg(file);
+        return false;
+    }
+
+    bool written = true;
+
+    bool res = cat(file, [&](const QByteArray& chunk) {
+        written = sink->write(chunk) == chunk.size();
+        return written;
+    }, bufferSize, sequential);
+
+    if (res && !written) {
+        qWarning() << QString("cat: %1: %2").arg(file).arg(sink->errorString());
+    }
+
+    return res && written;
+}
@@ -0,0 +1,528 @@
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QResource>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef Q_OS_WIN
+#include <qt_windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+#include "qtshellcopy.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+#endif
+
+using namespace QtShell::Private;
+
+#ifdef Q_OS_LINUX
+
+static const size_t BUFFER_SIZE = 1024 * 1024;
+
+// The errors mean the method is not supported between the two files. Try the next one.
+static bool isUnsupported(int error) {
+    return error == ENOSYS || error == EXDEV || error == EINVAL ||
+           error == EOPNOTSUPP || error == ENOTTY || error == EBADF;
+}
+
+static ssize_t _copy_file_range(int in, int out, size_t length) {
+#ifdef SYS_copy_file_range
+    // Call by syscall(), it is not available in glibc < 2.27
+    return syscall(SYS_copy_file_range, in, (loff_t*) 0, out, (loff_t*) 0, length, 0u);
+#else
+    Q_UNUSED(in);
+    Q_UNUSED(out);
+    Q_UNUSED(length);
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+typedef enum {
+    COPY_DONE,
+    COPY_UNSUPPORTED,
+    COPY_FAILED
+} CopyResult;
+
+static CopyResult copyByCopyFileRange(int in, int out, qint64 size) {
+    bool started = false;
+
+    forever {
+        ssize_t n = _copy_file_range(in, out, 1 << 30);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return !started && isUnsupported(errno) ? COPY_UNSUPPORTED : COPY_FAILED;
+        }
+
+        if (n == 0) {
+            // Some pseudo file systems report a size but copy nothing
+            if (!started && size > 0) {
+                return COPY_UNSUPPORTED;
+            }
+            break;
+        }
+        started = true;
+    }
+
+    return COPY_DONE;
+}
+
+static CopyResult copyBySendfile(int in, int out) {
+    bool started = false;
+
+    forever {
+        ssize_t n = ::sendfile(out, in, 0, 1 << 30);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return !started && isUnsupported(errno) ? COPY_UNSUPPORTED : COPY_FAILED;
+        }
+
+        if (n == 0) {
+            break;
+        }
+        started = true;
+    }
+
+    return COPY_DONE;
+}
+
+static CopyResult copyByReadWrite(int in, int out) {
+    QByteArray buffer(BUFFER_SIZE, Qt::Uninitialized);
+    char* data = buffer.data();
+
+    forever {
+        ssize_t n = ::read(in, data, BUFFER_SIZE);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return COPY_FAILED;
+        }
+
+        if (n == 0) {
+            break;
+        }
+
+        ssize_t written = 0;
+        while (written < n) {
+            ssize_t res = ::write(out, data + written, n - written);
+            if (res < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return COPY_FAILED;
+            }
+            written += res;
+        }
+    }
+
+    return COPY_DONE;
+}
+
+// Copy "length" bytes from the current offset of in to the current offset of out
+static CopyResult copyRange(int in, int out, qint64 length, bool& useCopyFileRange) {
+    while (length > 0 && useCopyFileRange) {
+        ssize_t n = _copy_file_range(in, out, qMin(length, (qint64) 1 << 30));
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!isUnsupported(errno)) {
+                return COPY_FAILED;
+            }
+            useCopyFileRange = false;
+            break;
+        }
+
+        if (n == 0) {
+            useCopyFileRange = false;
+            break;
+        }
+        length -= n;
+    }
+
+    QByteArray buffer;
+
+    while (length > 0) {
+        if (buffer.isEmpty()) {
+            buffer.resize(BUFFER_SIZE);
+        }
+
+        ssize_t n = ::read(in, buffer.data(), qMin(length, (qint64) BUFFER_SIZE));
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return COPY_FAILED;
+        }
+
+        if (n == 0) {
+            // The file is truncated while copying
+            return COPY_FAILED;
+        }
+
+        ssize_t written = 0;
+        while (written < n) {
+            ssize_t res = ::write(out, buffer.constData() + written, n - written);
+            if (res < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return COPY_FAILED;
+            }
+            written += res;
+        }
+        length -= n;
+    }
+
+    return COPY_DONE;
+}
+
+// Copy the data segments found by SEEK_DATA / SEEK_HOLE only. The holes are left unwritten, so they stay holes in the target
+static CopyResult copyBySeekData(int in, int out, qint64 size) {
+#ifdef SEEK_DATA
+    bool useCopyFileRange = true;
+    off_t offset = 0;
+
+    while (offset < size) {
+        off_t data = ::lseek(in, offset, SEEK_DATA);
+
+        if (data < 0) {
+            if (errno == ENXIO) {
+                // No more data. The rest is a hole
+                break;
+            }
+            return offset == 0 && isUnsupported(errno) ? COPY_UNSUPPORTED : COPY_FAILED;
+        }
+
+        off_t hole = ::lseek(in, data, SEEK_HOLE);
+        if (hole < 0) {
+            return COPY_FAILED;
+        }
+
+        if (::lseek(in, data, SEEK_SET) < 0 || ::lseek(out, data, SEEK_SET) < 0) {
+            return COPY_FAILED;
+        }
+
+        CopyResult result = copyRange(in, out, hole - data, useCopyFileRange);
+        if (result != COPY_DONE) {
+            return result;
+        }
+
+        offset = hole;
+    }
+
+    // Extend the target if the file ends with a hole
+    if (::ftruncate(out, size) != 0) {
+        return COPY_FAILED;
+    }
+
+    return COPY_DONE;
+#else
+    Q_UNUSED(in);
+    Q_UNUSED(out);
+    Q_UNUSED(size);
+    return COPY_UNSUPPORTED;
+#endif
+}
+
+static bool copyFileLinux(const QString& from, const QString& to, CopyMode mode) {
+    QByteArray source = QFile::encodeName(from);
+    QByteArray target = QFile::encodeName(to);
+
+    int in = ::open(source.constData(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(in, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(in);
+        return false;
+    }
+
+    int out = ::open(target.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+
+    CopyResult result = COPY_UNSUPPORTED;
+
+    if (mode != CopyData) {
+        if (ioctl(out, FICLONE, in) == 0) {
+            result = COPY_DONE;
+        } else if (mode == CopyReflink) {
+            result = COPY_FAILED;
+        }
+    }
+
+    // Fewer blocks allocated than the size: there are holes to keep
+    if (result == COPY_UNSUPPORTED && (qint64) st.st_blocks * 512 < (qint64) st.st_size) {
+        result = copyBySeekData(in, out, st.st_size);
+    }
+
+    if (result == COPY_UNSUPPORTED) {
+        result = copyByCopyFileRange(in, out, st.st_size);
+    }
+
+    if (result == COPY_UNSUPPORTED) {
+        result = copyBySendfile(in, out);
+    }
+
+    if (result == COPY_UNSUPPORTED) {
+        result = copyByReadWrite(in, out);
+    }
+
+    if (result == COPY_DONE && fchmod(out, st.st_mode & 07777) != 0) {
+        result = COPY_FAILED;
+    }
+
+    ::close(in);
+
+    if (::close(out) != 0) {
+        result = COPY_FAILED;
+    }
+
+    if (result != COPY_DONE) {
+        ::unlink(target.constData());
+        return false;
+    }
+
+    return true;
+}
+
+#endif
+
+// Write a qrc file straight from the data mapped in memory instead of going through the QFile engine and a temporary file
+static bool isCompressed(const QResource& resource) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    return resource.compressionAlgorithm() != QResource::NoCompression;
+#else
+    return resource.isCompressed();
+#endif
+}
+
+// The content of a compressed resource. A null QByteArray if it could not be uncompressed
+static QByteArray uncompressedData(const QResource& resource) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    return resource.uncompressedData();
+#else
+    return qUncompress(resource.data(), resource.size());
+#endif
+}
+
+static bool copyResource(const QString& from, const QString& to) {
+    QResource resource(from);
+
+    if (!resource.isValid() || QFileInfo(from).isDir()) {
+        return false;
+    }
+
+    const char* data = reinterpret_cast<const char*>(resource.data());
+    qint64 size = resource.size();
+    QByteArray uncompressed;
+
+    if (isCompressed(resource)) {
+        uncompressed = uncompressedData(resource);
+        if (uncompressed.isNull()) {
+            return QFile::copy(from, to);
+        }
+        data = uncompressed.constData();
+        size = uncompressed.size();
+    }
+
+    if (QFile::exists(to)) {
+        return false;
+    }
+
+    QFile file(to);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    bool res = true;
+    while (size > 0) {
+        qint64 written = file.write(data, size);
+        if (written <= 0) {
+            res = false;
+            break;
+        }
+        data += written;
+        size -= written;
+    }
+
+    file.close();
+
+    if (!res || file.error() != QFileDevice::NoError) {
+        file.remove();
+        return false;
+    }
+
+    // Same as QFile::copy()
+    file.setPermissions(QFileInfo(from).permissions());
+
+    return true;
+}
+
+static bool linkFile(const QString& from, const QString& to) {
+#if defined(Q_OS_WIN)
+    return CreateHardLinkW(reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(to).utf16()),
+                           reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(from).utf16()), 0);
+#else
+    return ::link(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) == 0;
+#endif
+}
+
+bool QtShell::Private::copyFile(const QString &from, const QString &to, CopyMode mode)
+{
+    bool resource = from.startsWith(QChar(':'));
+
+    if (mode == CopyHardlink) {
+        if (!resource && QFileInfo(from).isFile() && linkFile(from, to)) {
+            return true;
+        }
+        mode = CopyAuto;
+    }
+
+    if (resource) {
+        return mode != CopyReflink && copyResource(from, to);
+    }
+
+#ifdef Q_OS_LINUX
+    return copyFileLinux(from, to, mode);
+#else
+    return mode != CopyReflink && QFile::copy(from, to);
+#endif
+}
+
+// A hidden name next to the target, unique within the process
+static QString tempPath(const QString& target) {
+    static QAtomicInt counter;
+
+    QFileInfo info(target);
+    return QString("%1/.%2.qtshell-%3-%4").arg(info.path()).arg(info.fileName())
+            .arg(QCoreApplication::applicationPid()).arg(counter.fetchAndAddRelaxed(1));
+}
+
+bool QtShell::Private::replaceFile(const QString &from, const QString &to, CopyMode mode)
+{
+    // O_TMPFILE is not used: linkat() can not replace an existing file, so it would cost another link and rename
+    QString temp = tempPath(to);
+
+    if (!copyFile(from, temp, mode)) {
+        QFile::remove(temp);
+        return false;
+    }
+
+#if defined(Q_OS_WIN)
+    bool res = MoveFileExW(reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(temp).utf16()),
+                           reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(to).utf16()),
+                           MOVEFILE_REPLACE_EXISTING);
+#else
+    bool res = ::rename(QFile::encodeName(temp).constData(), QFile::encodeName(to).constData()) == 0;
+#endif
+
+    // rename() does nothing if both names are links of the same file. e.g the target is already linked to the source
+    if (!res || mode == CopyHardlink) {
+        QFile::remove(temp);
+    }
+
+    return res;
+}
+
+bool QtShell::Private::copyMetadata(const QString &from, const QString &to)
+{
+#ifdef Q_OS_UNIX
+    QByteArray source = QFile::encodeName(from);
+    QByteArray target = QFile::encodeName(to);
+
+    struct stat st;
+    if (::lstat(source.constData(), &st) != 0) {
+        return false;
+    }
+
+    // Only root could give the file away. Not an error otherwise
+    if (::lchown(target.constData(), st.st_uid, st.st_gid) != 0 && errno != EPERM) {
+        return false;
+    }
+
+    if (!S_ISLNK(st.st_mode) && ::chmod(target.constData(), st.st_mode & 07777) != 0) {
+        return false;
+    }
+
+    struct timespec times[2];
+#ifdef Q_OS_DARWIN
+    times[0] = st.st_atimespec;
+    times[1] = st.st_mtimespec;
+#else
+    times[0] = st.st_atim;
+    times[1] = st.st_mtim;
+#endif
+
+    return ::utimensat(AT_FDCWD, target.constData(), times, AT_SYMLINK_NOFOLLOW) == 0;
+#else
+    return QFile::setPermissions(to, QFileInfo(from).permissions());
+#endif
+}
+
+bool QtShell::Private::sameContent(const QString &file1, const QString &file2)
+{
+    QFile f1(file1);
+    QFile f2(file2);
+
+    if (f1.size() != f2.size()) {
+        return false;
+    }
+
+    if (!f1.open(QIODevice::ReadOnly) || !f2.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const qint64 chunkSize = 64 * 1024;
+    QByteArray buffer1(chunkSize, Qt::Uninitialized);
+    QByteArray buffer2(chunkSize, Qt::Uninitialized);
+
+    forever {
+        qint64 read1 = f1.read(buffer1.data(), chunkSize);
+        qint64 read2 = f2.read(buffer2.data(), chunkSize);
+
+        if (read1 < 0 || read1 != read2) {
+            return false;
+        }
+
+        if (read1 == 0) {
+            break;
+        }
+
+        if (memcmp(buffer1.constData(), buffer2.constData(), read1) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef QTSHELLCOPY_H
+#define QTSHELLCOPY_H
+
+#include <QString>
+
+namespace QtShell {
+
+    namespace Private {
+
+        enum CopyMode {
+            CopyAuto,     // Reflink if the file system supports it, otherwise copy the data
+            CopyReflink,  // Reflink only. Fail if it is not possible
+            CopyData,     // Always copy the data
+            CopyHardlink  // Hard link the source. Same as CopyAuto if it is not possible (e.g. across file systems)
+        };
+
+        /// Copy a regular file and its permissions, like QFile::copy(). It fails if the target exists.
+        /// On Linux the data is copied inside the kernel: it tries a reflink (FICLONE) first, then
+        /// copy_file_range(), then sendfile(), and finally a read/write loop with a large buffer.
+        /// A sparse file is copied segment by segment (SEEK_DATA / SEEK_HOLE), so the holes are kept.
+        /// A qrc file is written straight from the resource data (decompressed first if needed).
+        /// Other platforms use QFile::copy().
+        bool copyFile(const QString& from, const QString& to, CopyMode mode = CopyAuto);
+
+        /// Copy a file over an existing target atomically. The data is copied to a hidden file next to the target,
+        /// which is then renamed over it. Readers see either the old file or the complete new one, never a missing file.
+        bool replaceFile(const QString& from, const QString& to, CopyMode mode = CopyAuto);
+
+        /// Copy the permissions, access / modification times and, if allowed, the owner of a file, directory or symbolic link.
+        /// Only the permissions are copied on Windows.
+        bool copyMetadata(const QString& from, const QString& to);
+
+        /// Compare the content of two files chunk by chunk. It stops at the first difference.
+        bool sameContent(const QString& file1, const QString& file2);
+    }
+}
+
+#endif // QTSHELLCOPY_H
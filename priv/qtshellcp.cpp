@@ -0,0 +1,552 @@
+#include <QtCore>
+#include <QCommandLineParser>
+#include "qtshell.h"
+#include "priv/qtshellpriv.h"
+#include "priv/qtshellcopy.h"
+#include "priv/qtshelldirent.h"
+#include "priv/qtshellpool.h"
+#include "priv/qtshellprogress.h"
+
+using namespace QtShell::Private;
+
+namespace {
+
+    class CopyOptions {
+    public:
+        CopyOptions() : recursive(false), verbose(false), update(false), checksum(false), remove(false), threads(1),
+            mode(CopyAuto), progress(0) {
+        }
+
+        bool recursive;
+        bool verbose;
+
+        // Skip a file if the target has the same size and it is not older than the source (-u)
+        bool update;
+
+        // Compare the content instead of the modification time in update mode (-c)
+        bool checksum;
+
+        // Remove the files in the target directories that do not exist in the source (--delete)
+        bool remove;
+
+        int threads;
+
+        // Hard link (-l) or the reflink policy (--reflink=auto|always|never)
+        CopyMode mode;
+
+        QtShell::Progress* progress;
+    };
+
+    class CopyResult {
+    public:
+        QString from;
+        QString to;
+        bool ok;
+        bool skipped;
+        QString error;
+    };
+
+    /// Copy the files of a cp call. With threads > 1, files are copied by a pool of workers.
+    /// The no. of files in flight is bounded, and the results are reported in the order they were scheduled,
+    /// so the log and the warnings are the same as a single thread copy.
+    class CopyContext {
+    public:
+        CopyContext(Journal &journal, const CopyOptions& options) :
+            options(options), tracker(options.progress), journal(journal), pool(0), window(0), nextIndex(0), nextFlush(0), res(true) {
+            if (options.threads > 1) {
+                pool = new WorkStealingPool(options.threads);
+                window = options.threads * 16;
+            }
+        }
+
+        ~CopyContext() {
+            delete pool;
+        }
+
+        void copy(const QString& from, const QString& to);
+
+        /// Wait for all the files to be copied. Returns false if any of them failed.
+        bool finish();
+
+        const CopyOptions& options;
+
+        ProgressTracker tracker;
+
+    private:
+        void run(const QString& from, const QString& to, CopyResult& result) const;
+
+        bool isUpToDate(const QString& from, const QFileInfo& toInfo) const;
+
+        void report(const CopyResult& result);
+
+        // Report the results completed in order. The mutex must be locked.
+        void flush();
+
+        Journal &journal;
+
+        WorkStealingPool* pool;
+        int window;
+
+        QMutex mutex;
+        QWaitCondition changed;
+        QMap<int, CopyResult> completed;
+        int nextIndex;
+        int nextFlush;
+
+        bool res;
+    };
+
+}
+
+void CopyContext::copy(const QString &from, const QString &to)
+{
+    if (!pool) {
+        CopyResult result;
+        run(from, to, result);
+        report(result);
+        return;
+    }
+
+    int index = 0;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        forever {
+            flush();
+            if (nextIndex - nextFlush < window) {
+                break;
+            }
+            changed.wait(&mutex);
+        }
+
+        index = nextIndex++;
+    }
+
+    pool->submit([=]() {
+        CopyResult result;
+        run(from, to, result);
+
+        QMutexLocker locker(&mutex);
+        completed[index] = result;
+        changed.wakeAll();
+    });
+}
+
+bool CopyContext::finish()
+{
+    if (pool) {
+        pool->waitForDone();
+
+        QMutexLocker locker(&mutex);
+        flush();
+    }
+
+    return res;
+}
+
+void CopyContext::run(const QString &from, const QString &to, CopyResult &result) const
+{
+    result.from = from;
+    result.to = to;
+    result.ok = true;
+    result.skipped = false;
+
+    QFileInfo toInfo(to);
+
+    if (toInfo.exists()) {
+        if (options.update && isUpToDate(from, toInfo)) {
+            result.skipped = true;
+            tracker.add(1, 0);
+            return;
+        }
+
+        if (!replaceFile(from, to, options.mode)) {
+            result.error = QString("cp: %1: Failed to overwrite to %2").arg(from).arg(to);
+            result.ok = false;
+            return;
+        }
+    } else if (!copyFile(from, to, options.mode)) {
+        result.error = QString("cp: %1: Failed to copy to %2").arg(from).arg(to);
+        result.ok = false;
+        return;
+    }
+
+    if (tracker.isEnabled()) {
+        tracker.add(1, QFileInfo(to).size());
+    }
+}
+
+bool CopyContext::isUpToDate(const QString &from, const QFileInfo &toInfo) const
+{
+    QFileInfo fromInfo(from);
+
+    if (!toInfo.isFile() || fromInfo.size() != toInfo.size()) {
+        return false;
+    }
+
+    // A qrc file may not carry a modification time. Compare the content instead
+    if (options.checksum || !fromInfo.lastModified().isValid()) {
+        return sameContent(from, toInfo.filePath());
+    }
+
+    return toInfo.lastModified() >= fromInfo.lastModified();
+}
+
+void CopyContext::report(const CopyResult &result)
+{
+    if (result.skipped) {
+        return;
+    }
+
+    if (result.ok) {
+        if (options.verbose) {
+            qDebug().noquote() << QString("%1 -> %2").arg(result.from).arg(result.to);
+        }
+        journal.append(result.from, result.to);
+    } else {
+        qWarning() << result.error;
+        res = false;
+    }
+}
+
+void CopyContext::flush()
+{
+    while (completed.contains(nextFlush)) {
+        report(completed.take(nextFlush));
+        nextFlush++;
+    }
+}
+
+// Remove the entries of the target directory which are not in the source. Unlike the copy, hidden files are listed too,
+// so a hidden file is kept only if the source has it. A symbolic link is removed as a link, never followed.
+static bool removeExtraneous(const QString& from, const QString& to, bool verbose) {
+    QDir::Filters filters = QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot;
+    QSet<QString> names = QDir(from).entryList(filters).toSet();
+
+    QFileInfoList infos = QDir(to).entryInfoList(filters);
+
+    bool res = true;
+
+    for (int i = 0 ; i < infos.size() ; i++) {
+        const QFileInfo& info = infos.at(i);
+        if (names.contains(info.fileName())) {
+            continue;
+        }
+
+        QString path = joinPath(to, info.fileName());
+
+        if (verbose) {
+            qDebug().noquote() << QString("deleting %1").arg(path);
+        }
+
+        bool removed = typeOf(info) == QtShell::FindEntry::Dir ? QDir(path).removeRecursively() : QFile::remove(path);
+        if (!removed) {
+            qWarning() << QString("cp: %1: Failed to delete").arg(path);
+            res = false;
+        }
+    }
+
+    return res;
+}
+
+// Copy a directory recursively. The directories are created here in tree order, files are passed to the context.
+static bool copyTree(const QString& from, const QString& to, CopyContext& context) {
+    bool existed = QFileInfo(to).isDir();
+    if (!existed) {
+        QtShell::mkdir(to);
+    }
+
+    QList<DirEntry> entries;
+    readDir(from, entries);
+
+    bool res = true;
+
+    if (existed && context.options.remove) {
+        res = removeExtraneous(from, to, context.options.verbose);
+    }
+
+    for (int i = 0 ; i < entries.size() ; i++) {
+        const DirEntry& entry = entries.at(i);
+        QString childFrom = joinPath(from, entry.name);
+        QString childTo = joinPath(to, entry.name);
+
+        if (entry.isDir) {
+            res = copyTree(childFrom, childTo, context) && res;
+        } else {
+            context.copy(childFrom, childTo);
+        }
+    }
+
+    return res;
+}
+
+// Count the files and bytes of a tree for the scan phase. It lists and follows the links the same way as copyTree()
+static void scanTree(const QString& path, qint64& files, qint64& bytes) {
+    QList<DirEntry> entries;
+    readDir(path, entries, false);
+
+    for (int i = 0 ; i < entries.size() ; i++) {
+        const DirEntry& entry = entries.at(i);
+        QString child = joinPath(path, entry.name);
+
+        if (entry.isDir) {
+            scanTree(child, files, bytes);
+        } else {
+            files++;
+            bytes += entry.info.filePath().isEmpty() ? QFileInfo(child).size() : entry.info.size();
+        }
+    }
+}
+
+// Add the names, sizes and modification times of a tree to the hash.
+// The content is only hashed for a qrc file which does not carry a modification time
+static void hashTree(const QString& path, const QString& relativePath, QCryptographicHash& hash) {
+    QList<DirEntry> entries;
+    readDir(path, entries);
+
+    for (int i = 0 ; i < entries.size() ; i++) {
+        const DirEntry& entry = entries.at(i);
+        QString child = joinPath(path, entry.name);
+        QString relativeChild = relativePath.isEmpty() ? entry.name : relativePath + "/" + entry.name;
+
+        hash.addData(relativeChild.toUtf8());
+        hash.addData("\0", 1);
+
+        if (entry.isDir) {
+            hash.addData("/", 1);
+            hashTree(child, relativeChild, hash);
+            continue;
+        }
+
+        QFileInfo info = entry.info.filePath().isEmpty() ? QFileInfo(child) : entry.info;
+        QResource resource(child);
+
+        // QFileInfo::size() may need to decompress a qrc file. QResource::size() does not
+        hash.addData(QByteArray::number(resource.isValid() ? resource.size() : info.size()));
+
+        QDateTime lastModified = info.lastModified();
+        if (lastModified.isValid() || !resource.isValid()) {
+            hash.addData(QByteArray::number(lastModified.toMSecsSinceEpoch()));
+        } else {
+            hash.addData(reinterpret_cast<const char*>(resource.data()), resource.size());
+        }
+    }
+}
+
+// The real cp function
+static bool _cp(QString source,
+                QString target,
+                Journal &journal,
+                const CopyOptions& options = CopyOptions()) {
+
+    if (source.isEmpty() || target.isEmpty()) {
+        qWarning() << "cp(const QString &source, const QString &target)";
+        return false;
+    }
+
+    CopyContext context(journal, options);
+
+    if (context.tracker.scan()) {
+        qint64 files = 0;
+        qint64 bytes = 0;
+
+        context.tracker.startScan();
+        bulk(source, target, [&](const QString& from , const QString& to, const QFileInfo& fromInfo) {
+            Q_UNUSED(to);
+            if (!fromInfo.isDir()) {
+                files++;
+                bytes += fromInfo.size();
+            } else if (options.recursive) {
+                scanTree(from, files, bytes);
+            }
+            return true;
+        });
+        context.tracker.setTotal(files, bytes);
+    }
+
+    context.tracker.startTransfer();
+
+    int code = bulk(source, target, [&](const QString& from , const QString& to, const QFileInfo& fromInfo) {
+        if (fromInfo.isDir()) {
+            if (!options.recursive) {
+                qWarning() << QString("cp: %1 is a directory (not copied)").arg(from);
+                return false;
+            }
+            return copyTree(from, to, context);
+        }
+
+        context.copy(from, to);
+        return true;
+    });
+
+    bool res = context.finish();
+    context.tracker.finish();
+
+    switch (code) {
+    case NO_SUCH_FILE_OR_DIR:
+        qWarning() << QString("cp: %1: No such file or directory").arg(source);
+        break;
+    case INVALID_TARGET:
+        qWarning() << QString("cp: %1 %2: Invalid target").arg(source).arg(target);
+        break;
+    }
+
+    return code == NO_ERROR && res;
+}
+
+bool QtShell::cp(const QString &source, const QString &target)
+{
+    NullJournal journal;
+
+    return _cp(source, target, journal);
+}
+
+bool QtShell::cp(const QString &source, const QString &target, QList<QPair<QString, QString> > &log)
+{
+    LogJournal journal(log);
+    return _cp(source, target, journal);
+}
+
+bool QtShell::cp(const QString& options, const QString& source , const QString &target) {
+    NullJournal journal;
+    return cp(options, source, target, journal);
+}
+
+static bool parseOptions(const QString& options, CopyOptions& copyOptions) {
+    QCommandLineParser parser;
+    parser.addOption(QCommandLineOption("v"));
+    parser.addOption(QCommandLineOption("R"));
+    parser.addOption(QCommandLineOption("a"));
+    parser.addOption(QCommandLineOption("u"));
+    parser.addOption(QCommandLineOption("c"));
+    parser.addOption(QCommandLineOption("delete"));
+    parser.addOption(QCommandLineOption("l"));
+    parser.addOption(QCommandLineOption("reflink", "", "when"));
+    parser.addOption(QCommandLineOption("j", "", "jobs"));
+
+    // Options could be passed as "-a -j 4"
+    if (!parser.parse(QStringList() << "cp" << options.split(QChar(' '), QString::SkipEmptyParts))) {
+        qWarning() << QString("cp: %1").arg(parser.errorText());
+        return false;
+    }
+
+    copyOptions.recursive = parser.isSet("R") || parser.isSet("a");
+    copyOptions.verbose = parser.isSet("v");
+    copyOptions.checksum = parser.isSet("c");
+    copyOptions.update = parser.isSet("u") || copyOptions.checksum;
+    copyOptions.remove = parser.isSet("delete");
+
+    if (parser.isSet("reflink")) {
+        QString when = parser.value("reflink");
+        if (when == "auto") {
+            copyOptions.mode = CopyAuto;
+        } else if (when == "always") {
+            copyOptions.mode = CopyReflink;
+        } else if (when == "never") {
+            copyOptions.mode = CopyData;
+        } else {
+            qWarning() << QString("cp: --reflink: %1: Invalid argument").arg(when);
+            return false;
+        }
+    }
+
+    if (parser.isSet("l")) {
+        copyOptions.mode = CopyHardlink;
+    }
+
+    if (parser.isSet("j")) {
+        bool ok = false;
+        copyOptions.threads = WorkStealingPool::resolveThreadCount(parser.value("j").toInt(&ok));
+        if (!ok) {
+            qWarning() << QString("cp: -j: %1: Invalid number").arg(parser.value("j"));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool QtShell::cp(const QString &options, const QString &source, const QString &target, QList<QPair<QString, QString> > &log)
+{
+    CopyOptions copyOptions;
+    if (!parseOptions(options, copyOptions)) {
+        return false;
+    }
+
+    LogJournal journal(log);
+    return _cp(source, target, journal, copyOptions);
+}
+
+bool QtShell::cp(const QString &options, const QString &source, const QString &target, Journal &journal)
+{
+    CopyOptions copyOptions;
+    if (!parseOptions(options, copyOptions)) {
+        return false;
+    }
+
+    return _cp(source, target, journal, copyOptions);
+}
+
+bool QtShell::cp(const QString &options, const QString &source, const QString &target, Progress &progress)
+{
+    CopyOptions copyOptions;
+    if (!parseOptions(options, copyOptions)) {
+        return false;
+    }
+    copyOptions.progress = &progress;
+
+    NullJournal journal;
+    return _cp(source, target, journal, copyOptions);
+}
+
+bool QtShell::extract(const QString &source, const QString &target, int threads)
+{
+    if (!QFileInfo(source).isDir()) {
+        qWarning() << QString("extract: %1: No such directory").arg(source);
+        return false;
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(source.toUtf8());
+    hashTree(source, QString(), hash);
+    QByteArray manifest = hash.result().toHex();
+
+    QString manifestFile = joinPath(target, ".qtshell-manifest");
+
+    {
+        QFile file(manifestFile);
+        if (file.open(QIODevice::ReadOnly) && file.readAll().trimmed() == manifest) {
+            return true;
+        }
+    }
+
+    if (!QtShell::mkdir("-p", target)) {
+        return false;
+    }
+
+    // Drop the old manifest first, so an interrupted extraction is never taken as complete
+    QFile::remove(manifestFile);
+
+    NullJournal journal;
+    CopyOptions options;
+    options.recursive = true;
+    options.update = true;
+    options.threads = WorkStealingPool::resolveThreadCount(threads);
+
+    CopyContext context(journal, options);
+    bool res = copyTree(source, target, context);
+    res = context.finish() && res;
+
+    if (!res) {
+        return false;
+    }
+
+    QFile file(manifestFile);
+    if (!file.open(QIODevice::WriteOnly) || file.write(manifest + "\n") < 0) {
+        qWarning() << QString("extract: %1: Failed to write the manifest").arg(manifestFile);
+        return false;
+    }
+
+    return true;
+}
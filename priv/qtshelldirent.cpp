@@ -0,0 +1,168 @@
+#include <QDir>
+#include <QFile>
+#include <algorithm>
+#include "qtshelldirent.h"
+
+#ifdef Q_OS_LINUX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace QtShell;
+using namespace QtShell::Private;
+
+QtShell::Private::DirEntry::DirEntry() : type(FindEntry::Unknown), isDir(false)
+{
+}
+
+FindEntry::Type QtShell::Private::typeOf(const QFileInfo &info)
+{
+    if (info.isSymLink()) {
+        return FindEntry::SymLink;
+    } else if (info.isDir()) {
+        return FindEntry::Dir;
+    } else if (info.isFile()) {
+        return FindEntry::File;
+    }
+    return FindEntry::Other;
+}
+
+QString QtShell::Private::joinPath(const QString &path, const QString &name)
+{
+    if (path.endsWith(QChar('/'))) {
+        return path + name;
+    }
+    return path + QChar('/') + name;
+}
+
+static bool readQDir(const QString& path, QList<DirEntry>& entries, bool sorted) {
+    QDir dir(path);
+
+    if (!dir.exists()) {
+        return false;
+    }
+
+    QDir::SortFlags sort = sorted ? (QDir::Name | QDir::IgnoreCase) : QDir::Unsorted;
+    QFileInfoList infos = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot, sort);
+
+    for (int i = 0 ; i < infos.size() ; i++) {
+        const QFileInfo& info = infos.at(i);
+        DirEntry entry;
+        entry.name = info.fileName();
+        entry.type = typeOf(info);
+        entry.isDir = info.isDir();
+        entry.info = info;
+        entries << entry;
+    }
+
+    return true;
+}
+
+#ifdef Q_OS_LINUX
+
+static bool nameLessThan(const DirEntry& a, const DirEntry& b) {
+    int res = a.name.compare(b.name, Qt::CaseInsensitive);
+    if (res == 0) {
+        return a.name < b.name;
+    }
+    return res < 0;
+}
+
+static FindEntry::Type typeOfMode(mode_t mode) {
+    if (S_ISLNK(mode)) {
+        return FindEntry::SymLink;
+    } else if (S_ISDIR(mode)) {
+        return FindEntry::Dir;
+    } else if (S_ISREG(mode)) {
+        return FindEntry::File;
+    }
+    return FindEntry::Other;
+}
+
+static bool readRawDir(const QString& path, QList<DirEntry>& entries, bool sorted) {
+    QByteArray encodedPath = QFile::encodeName(path);
+    int fd = ::open(encodedPath.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    DIR* dir = fdopendir(fd);
+    if (!dir) {
+        ::close(fd);
+        return false;
+    }
+
+    struct dirent* ent;
+    struct stat st;
+
+    while ((ent = readdir(dir)) != 0) {
+        const char* name = ent->d_name;
+
+        if (name[0] == '.') {
+            // ".", ".." and hidden files
+            continue;
+        }
+
+        DirEntry entry;
+
+        switch (ent->d_type) {
+        case DT_DIR:
+            entry.type = FindEntry::Dir;
+            entry.isDir = true;
+            break;
+        case DT_REG:
+            entry.type = FindEntry::File;
+            break;
+        case DT_LNK:
+            entry.type = FindEntry::SymLink;
+            break;
+        case DT_UNKNOWN:
+            if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                continue;
+            }
+            entry.type = typeOfMode(st.st_mode);
+            entry.isDir = S_ISDIR(st.st_mode);
+            break;
+        default:
+            entry.type = FindEntry::Other;
+            break;
+        }
+
+        if (entry.type == FindEntry::SymLink) {
+            // Follow the link like QFileInfo::isDir(). A broken link is skipped.
+            if (fstatat(fd, name, &st, 0) != 0) {
+                continue;
+            }
+            entry.isDir = S_ISDIR(st.st_mode);
+        } else if (entry.type == FindEntry::Other) {
+            continue;
+        }
+
+        entry.name = QFile::decodeName(name);
+        entries << entry;
+    }
+
+    closedir(dir);
+
+    if (sorted) {
+        std::sort(entries.begin(), entries.end(), nameLessThan);
+    }
+
+    return true;
+}
+
+#endif
+
+bool QtShell::Private::readDir(const QString &path, QList<DirEntry> &entries, bool sorted)
+{
+#ifdef Q_OS_LINUX
+    if (!path.startsWith(QChar(':'))) {
+        return readRawDir(path, entries, sorted);
+    }
+#endif
+
+    return readQDir(path, entries, sorted);
+}
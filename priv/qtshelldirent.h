@@ -0,0 +1,43 @@
+#ifndef QTSHELLDIRENT_H
+#define QTSHELLDIRENT_H
+
+#include <QString>
+#include <QList>
+#include <QFileInfo>
+#include "qtshell.h"
+
+namespace QtShell {
+
+    namespace Private {
+
+        class DirEntry {
+        public:
+            DirEntry();
+
+            QString name;
+
+            /// Type of the entry itself (lstat)
+            FindEntry::Type type;
+
+            /// It is a directory or a symbolic link to a directory (stat)
+            bool isDir;
+
+            /// Only available if the listing is done by QDir
+            QFileInfo info;
+        };
+
+        /// List a directory with the same filter as the default of QDir: "." , "..", hidden files, broken symbolic links
+        /// and special files are skipped. On Linux it reads the entries by readdir() and takes the type from d_type.
+        /// It only stats an entry if d_type is unknown or it is a symbolic link. Other platforms and qrc paths use QDir.
+        /// If sorted is true, the entries are sorted by name case insensitively like QDir::Name | QDir::IgnoreCase.
+        /// Returns false if the directory could not be opened.
+        bool readDir(const QString& path, QList<DirEntry>& entries, bool sorted = true);
+
+        /// Join a directory path and an entry name
+        QString joinPath(const QString& path, const QString& name);
+
+        FindEntry::Type typeOf(const QFileInfo& info);
+    }
+}
+
+#endif // QTSHELLDIRENT_H
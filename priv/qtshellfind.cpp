@@ -0,0 +1,529 @@
+#include <QtCore>
+#include <QDir>
+#include <QQueue>
+#include "qtshell.h"
+#include "priv/qtshellpriv.h"
+#include "priv/qtshellpool.h"
+#include "priv/qtshelldirent.h"
+#include "priv/qtshellfind.h"
+
+using namespace QtShell;
+using namespace QtShell::Private;
+
+namespace {
+
+    /// An entry found by the ordered parallel walk
+    class FindRecord {
+    public:
+        FindEntry entry;
+        bool matched;
+        bool descend;
+    };
+
+    /// A directory of the ordered parallel walk. It keeps the entries in listing order until they are replayed,
+    /// so that the result of a single thread walk could be reproduced.
+    class FindNode {
+    public:
+        FindNode(const QString& path, int depth) : path(path), depth(depth), tag(-1), scanned(false) {
+        }
+
+        QString path;
+        int depth;
+        int tag;
+        // Set by the worker when records is filled. Guarded by the mutex of the walk
+        bool scanned;
+        QList<FindRecord> records;
+    };
+
+}
+
+// The no. of directories per thread that the ordered parallel walk scans ahead of the replay
+static const int ORDERED_WINDOW_PER_THREAD = 16;
+
+FindWalker::FindWalker(const FindOptions &options, const QString &root, const GlobMatcher &matcher) :
+    options(options), root(root), matcher(matcher), resolvePaths(true)
+{
+    if (!options.prune.isEmpty()) {
+        pruneMatcher = GlobMatcher(options.prune);
+    }
+
+    for (int i = 0 ; i < options.type.size() ; i++) {
+        QChar c = options.type.at(i);
+        if (c == QChar('f') || c == QChar('d') || c == QChar('l')) {
+            types.append(c);
+        } else if (c != QChar(',')) {
+            qWarning() << QString("find: -type: %1: unknown type").arg(c);
+        }
+    }
+
+    QDir dir(realpath_strip(root));
+    absRoot = dir.absolutePath();
+}
+
+QString FindWalker::resolve(const QString& path) const
+{
+    // All the paths visited are started with absRoot. Replace it by the root passed to find()
+    QString res;
+    res.reserve(root.size() + path.size() - absRoot.size());
+    res.append(root);
+    res.append(path.midRef(absRoot.size()));
+    return res;
+}
+
+bool FindWalker::canDescend(int depth) const
+{
+    return options.maxdepth < 0 || depth < options.maxdepth;
+}
+
+bool FindWalker::accept(const FindEntry &entry, const QString &name) const
+{
+    // Cheap predicates go first. The stat data is only fetched if a size or time predicate is set.
+    if (entry.depth < options.mindepth) {
+        return false;
+    }
+
+    if (!types.isEmpty()) {
+        QChar c;
+        switch (entry.type) {
+        case FindEntry::File:
+            c = QChar('f');
+            break;
+        case FindEntry::Dir:
+            c = QChar('d');
+            break;
+        case FindEntry::SymLink:
+            c = QChar('l');
+            break;
+        default:
+            return false;
+        }
+
+        if (!types.contains(c)) {
+            return false;
+        }
+    }
+
+    if (!matcher.match(name)) {
+        return false;
+    }
+
+    if (options.minsize >= 0 || options.maxsize >= 0) {
+        qint64 size = entry.info().size();
+        if ((options.minsize >= 0 && size < options.minsize) ||
+            (options.maxsize >= 0 && size > options.maxsize)) {
+            return false;
+        }
+    }
+
+    if (options.newer.isValid() || options.older.isValid()) {
+        QDateTime modified = entry.info().lastModified();
+        if ((options.newer.isValid() && modified <= options.newer) ||
+            (options.older.isValid() && modified >= options.older)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool FindWalker::evaluate(FindEntry &entry, bool isDir, bool &matched, bool &descend) const
+{
+    if (isDir && !pruneMatcher.isEmpty() && pruneMatcher.match(entry.fileName)) {
+        return false;
+    }
+
+    matched = accept(entry, entry.fileName);
+    descend = isDir && canDescend(entry.depth);
+
+    if (!matched && !descend) {
+        return false;
+    }
+
+    if (matched && resolvePaths) {
+        entry.path = resolve(entry.absoluteFilePath);
+    }
+
+    return true;
+}
+
+template <typename Func>
+bool FindWalker::scan(const QString &path, int depth, Func func) const
+{
+    QList<DirEntry> entries;
+
+    if (lister) {
+        lister(path, entries);
+    } else {
+        readDir(path, entries, options.sorted);
+    }
+
+    for (int i = 0 ; i < entries.size() ; i++) {
+        const DirEntry& item = entries.at(i);
+
+        FindEntry entry;
+        entry.absoluteFilePath = joinPath(path, item.name);
+        entry.fileName = item.name;
+        entry.depth = depth + 1;
+        entry.type = item.type;
+        entry.m_info = item.info;
+
+        // Symbolic links to directories are followed
+        if (!func(entry, item.isDir)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void FindWalker::setLister(const DirLister &lister)
+{
+    this->lister = lister;
+}
+
+bool FindWalker::run(const FindVisitor &visitor)
+{
+    return walk([&](FindEntry& entry, bool matched, int parent, int& tag) {
+        Q_UNUSED(parent);
+        Q_UNUSED(tag);
+        if (!matched) {
+            return FindContinue;
+        }
+        return visitor(entry);
+    });
+}
+
+bool FindWalker::run(FindResult &result)
+{
+    result.clear();
+    result.m_root = root;
+    result.m_rootSeparator = !absRoot.endsWith(QChar('/'));
+    resolvePaths = false;
+
+    return walk([&](FindEntry& entry, bool matched, int parent, int& tag) {
+        tag = result.append(parent, parent < 0 ? QString() : entry.fileName, matched);
+        return FindContinue;
+    });
+}
+
+bool FindWalker::walk(const Handler &handler)
+{
+    if (options.limit == 0) {
+        return true;
+    }
+
+    int count = 0;
+    bool limited = false;
+
+    bool res = traverse([&](FindEntry& entry, bool matched, int parent, int& tag) {
+        FindAction action = handler(entry, matched, parent, tag);
+
+        if (matched && action != FindStop && options.limit > 0 && ++count >= options.limit) {
+            limited = true;
+            action = FindStop;
+        }
+
+        return action;
+    });
+
+    return res || limited;
+}
+
+bool FindWalker::traverse(const Handler &handler)
+{
+    FindEntry rootEntry;
+    rootEntry.path = root;
+    rootEntry.absoluteFilePath = absRoot;
+    rootEntry.fileName = QtShell::basename(absRoot);
+    rootEntry.depth = 0;
+    rootEntry.type = typeOf(rootEntry.info());
+
+    // The starting point is matched as an empty name. It is only reported if a filter like "*" is given.
+    int rootTag = -1;
+    FindAction action = handler(rootEntry, accept(rootEntry, ""), -1, rootTag);
+
+    if (action == FindStop) {
+        return false;
+    } else if (action == FindPrune || !canDescend(0)) {
+        return true;
+    }
+
+    int threads = WorkStealingPool::resolveThreadCount(options.threads);
+    if (threads > 1) {
+        return options.ordered ? walkParallelOrdered(handler, rootTag, threads) :
+                                 walkParallel(handler, rootTag, threads);
+    }
+
+    class QueueItem {
+    public:
+        QueueItem(QString path, int depth, int tag) : path(path) , depth(depth), tag(tag) {
+        }
+        QString path;
+        int depth;
+        int tag;
+    };
+
+    QQueue<QueueItem> queue;
+    queue.enqueue(QueueItem(absRoot, 0, rootTag));
+
+    while (queue.size() > 0) {
+        QueueItem current = queue.dequeue();
+
+        bool res = scan(current.path, current.depth, [&](FindEntry& entry, bool isDir) {
+            bool matched = false;
+            bool descend = false;
+
+            if (!evaluate(entry, isDir, matched, descend)) {
+                return true;
+            }
+
+            int tag = -1;
+            FindAction action = handler(entry, matched, current.tag, tag);
+
+            if (action == FindStop) {
+                return false;
+            }
+
+            if (descend && action != FindPrune) {
+                queue.enqueue(QueueItem(entry.absoluteFilePath, entry.depth, tag));
+            }
+            return true;
+        });
+
+        if (!res) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool FindWalker::walkParallel(const Handler &handler, int rootTag, int threads)
+{
+    WorkStealingPool pool(threads);
+    QMutex mutex;
+    bool stopped = false;
+
+    std::function<void(const QString&, int, int)> visit = [&](const QString& path, int depth, int parent) {
+        scan(path, depth, [&](FindEntry& entry, bool isDir) {
+            bool matched = false;
+            bool descend = false;
+
+            if (!evaluate(entry, isDir, matched, descend)) {
+                return true;
+            }
+
+            int tag = -1;
+            FindAction action = FindContinue;
+
+            {
+                QMutexLocker locker(&mutex);
+                if (stopped) {
+                    return false;
+                }
+
+                action = handler(entry, matched, parent, tag);
+
+                if (action == FindStop) {
+                    stopped = true;
+                    pool.cancel();
+                    return false;
+                }
+            }
+
+            if (descend && action != FindPrune) {
+                QString childPath = entry.absoluteFilePath;
+                int childDepth = entry.depth;
+                pool.submit([&visit, childPath, childDepth, tag]() {
+                    visit(childPath, childDepth, tag);
+                });
+            }
+            return true;
+        });
+    };
+
+    pool.submit([&]() {
+        visit(absRoot, 0, rootTag);
+    });
+    pool.waitForDone();
+
+    return !stopped;
+}
+
+bool FindWalker::walkParallelOrdered(const Handler &handler, int rootTag, int threads)
+{
+    // The directories are scanned on the pool and replayed on this thread in the same breadth-first order as the single
+    // thread walk. A directory is only submitted when the replay has reached its parent and a window of directories ahead
+    // of the replay is not full. So a pruned directory is not walked, a stop takes effect at once, and only the entries
+    // of the window are held in memory.
+    const int window = threads * ORDERED_WINDOW_PER_THREAD;
+
+    QMutex mutex;
+    QWaitCondition scanned;
+
+    // The directories waiting for the replay, in replay order. The first "submitted" of them are submitted to the pool
+    QQueue<FindNode*> queue;
+    int submitted = 0;
+
+    WorkStealingPool pool(threads);
+
+    auto visit = [&](FindNode* node) {
+        QList<FindRecord> records;
+
+        scan(node->path, node->depth, [&](FindEntry& entry, bool isDir) {
+            FindRecord record;
+            record.matched = false;
+            record.descend = false;
+
+            if (!evaluate(entry, isDir, record.matched, record.descend)) {
+                return true;
+            }
+
+            record.entry = entry;
+            records << record;
+            return !pool.isCanceled();
+        });
+
+        QMutexLocker locker(&mutex);
+        node->records.swap(records);
+        node->scanned = true;
+        scanned.wakeAll();
+    };
+
+    auto fill = [&]() {
+        while (submitted < queue.size() && submitted < window) {
+            FindNode* node = queue.at(submitted++);
+            pool.submit([&visit, node]() {
+                visit(node);
+            });
+        }
+    };
+
+    FindNode* rootNode = new FindNode(absRoot, 0);
+    rootNode->tag = rootTag;
+    queue.enqueue(rootNode);
+
+    bool stopped = false;
+
+    while (!stopped && queue.size() > 0) {
+        fill();
+
+        FindNode* node = queue.head();
+        {
+            QMutexLocker locker(&mutex);
+            while (!node->scanned) {
+                scanned.wait(&mutex);
+            }
+        }
+
+        queue.dequeue();
+        submitted--;
+
+        for (int i = 0 ; i < node->records.size() ; i++) {
+            FindRecord& record = node->records[i];
+            int tag = -1;
+            FindAction action = handler(record.entry, record.matched, node->tag, tag);
+
+            if (action == FindStop) {
+                stopped = true;
+                break;
+            }
+
+            if (record.descend && action != FindPrune) {
+                FindNode* child = new FindNode(record.entry.absoluteFilePath, record.entry.depth);
+                child->tag = tag;
+                queue.enqueue(child);
+                fill();
+            }
+        }
+
+        delete node;
+    }
+
+    // The submitted directories may still be scanned
+    pool.cancel();
+    pool.waitForDone();
+    qDeleteAll(queue);
+
+    return !stopped;
+}
+
+bool QtShell::find(const FindOptions &options, const QString &root, const GlobMatcher &matcher, const FindVisitor &visitor)
+{
+    FindWalker walker(options, root, matcher);
+    return walker.run(visitor);
+}
+
+bool QtShell::find(const FindOptions &options, const QString &root, const QStringList &nameFilters, const FindVisitor &visitor)
+{
+    return find(options, root, GlobMatcher(nameFilters), visitor);
+}
+
+bool QtShell::find(const FindOptions &options, const QString &root, const GlobMatcher &matcher, FindResult &result)
+{
+    FindWalker walker(options, root, matcher);
+    return walker.run(result);
+}
+
+bool QtShell::find(const FindOptions &options, const QString &root, const QStringList &nameFilters, FindResult &result)
+{
+    return find(options, root, GlobMatcher(nameFilters), result);
+}
+
+QStringList QtShell::find(const QtShell::FindOptions &options, const QString &root, const QStringList &nameFilters)
+{
+    return find(options, root, GlobMatcher(nameFilters));
+}
+
+QStringList QtShell::find(const QtShell::FindOptions &options, const QString &root, const QtShell::GlobMatcher &matcher)
+{
+    QStringList result;
+
+    find(options, root, matcher, [&](const FindEntry& entry) {
+        result << entry.path;
+        return FindContinue;
+    });
+
+    return result;
+}
+
+
+QStringList QtShell::find(const QString &root, const QStringList &nameFilters)
+{
+    FindOptions options;
+    return find(options, root, nameFilters);
+}
+
+QStringList QtShell::find(const QString &path, const QString &nameFilter)
+{
+    QStringList nameFilters;
+    if (!nameFilter.isEmpty()) {
+        nameFilters << nameFilter;
+    }
+
+    return find(path, nameFilters);
+}
+
+QtShell::FindOptions::FindOptions()
+{
+    maxdepth = -1;
+    threads = 1;
+    ordered = false;
+    sorted = true;
+    mindepth = -1;
+    minsize = -1;
+    maxsize = -1;
+    limit = -1;
+}
+
+QtShell::FindEntry::FindEntry() : depth(0), type(Unknown)
+{
+}
+
+QFileInfo QtShell::FindEntry::info() const
+{
+    if (m_info.filePath().isEmpty() && !absoluteFilePath.isEmpty()) {
+        m_info = QFileInfo(absoluteFilePath);
+    }
+    return m_info;
+}
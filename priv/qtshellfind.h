@@ -0,0 +1,72 @@
+#ifndef QTSHELLFIND_H
+#define QTSHELLFIND_H
+
+#include <QString>
+#include <QList>
+#include <functional>
+#include "qtshell.h"
+#include "priv/qtshelldirent.h"
+
+namespace QtShell {
+
+    namespace Private {
+
+        typedef std::function<bool(const QString& path, QList<DirEntry>& entries)> DirLister;
+
+        class FindWalker {
+        public:
+            /// Called for each entry which is matched by the name filters or it is a directory to be descended.
+            /// "parent" is the tag of its directory. The handler may set "tag" of a directory, it will be passed
+            /// as "parent" for the entries inside. The handler is never called concurrently.
+            typedef std::function<FindAction(FindEntry& entry, bool matched, int parent, int& tag)> Handler;
+
+            FindWalker(const FindOptions& options, const QString& root, const GlobMatcher& matcher);
+
+            bool run(const FindVisitor& visitor);
+
+            bool run(FindResult& result);
+
+            /// Replace the directory listing function. By default it is readDir().
+            /// It is called from the worker threads when FindOptions::threads != 1
+            void setLister(const DirLister& lister);
+
+        private:
+            QString resolve(const QString& path) const;
+
+            bool canDescend(int depth) const;
+
+            /// Evaluate the predicates of FindOptions on an entry. "name" is the name to be matched by the name filters.
+            bool accept(const FindEntry& entry, const QString& name) const;
+
+            /// Decide what to do with an entry found in a directory. Returns false if it should be skipped entirely.
+            bool evaluate(FindEntry& entry, bool isDir, bool& matched, bool& descend) const;
+
+            /// List a directory. func(FindEntry& entry, bool isDir) is called per entry. Return false to stop the listing.
+            template <typename Func>
+            bool scan(const QString& path, int depth, Func func) const;
+
+            /// Walk the tree and stop when FindOptions::limit is reached
+            bool walk(const Handler& handler);
+
+            bool traverse(const Handler& handler);
+
+            bool walkParallel(const Handler& handler, int rootTag, int threads);
+
+            bool walkParallelOrdered(const Handler& handler, int rootTag, int threads);
+
+            FindOptions options;
+            QString root;
+            QString absRoot;
+            GlobMatcher matcher;
+            GlobMatcher pruneMatcher;
+            QString types;
+            DirLister lister;
+
+            // Fill FindEntry::path of matched entries
+            bool resolvePaths;
+        };
+
+    }
+}
+
+#endif // QTSHELLFIND_H
@@ -0,0 +1,73 @@
+#include <QRunnable>
+#include <QThreadPool>
+#include <QFutureInterface>
+#include <QElapsedTimer>
+#include "qtshell.h"
+
+using namespace QtShell;
+
+namespace {
+
+    class FindTask : public QRunnable {
+    public:
+        // Report a batch when it is full or it has been held for too long
+        enum {
+            BATCH_SIZE = 256,
+            BATCH_INTERVAL = 50 // ms
+        };
+
+        FindTask(const FindOptions& options, const QString& root, const QStringList& nameFilters) :
+            options(options), root(root), nameFilters(nameFilters) {
+        }
+
+        void run() override {
+            if (!futureInterface.isCanceled()) {
+                QVector<QString> batch;
+                QElapsedTimer timer;
+                timer.start();
+
+                QtShell::find(options, root, nameFilters, [&](const FindEntry& entry) {
+                    if (futureInterface.isCanceled()) {
+                        return FindStop;
+                    }
+
+                    batch << entry.path;
+
+                    if (batch.size() >= BATCH_SIZE || timer.elapsed() >= BATCH_INTERVAL) {
+                        futureInterface.reportResults(batch);
+                        batch.clear();
+                        timer.restart();
+                    }
+                    return FindContinue;
+                });
+
+                if (!batch.isEmpty() && !futureInterface.isCanceled()) {
+                    futureInterface.reportResults(batch);
+                }
+            }
+
+            futureInterface.reportFinished();
+        }
+
+        QFutureInterface<QString> futureInterface;
+        FindOptions options;
+        QString root;
+        QStringList nameFilters;
+    };
+
+}
+
+QFuture<QString> QtShell::findAsync(const FindOptions &options, const QString &path, const QStringList &nameFilters, QThreadPool *pool)
+{
+    FindTask* task = new FindTask(options, path, nameFilters);
+    task->futureInterface.reportStarted();
+    QFuture<QString> future = task->futureInterface.future();
+
+    if (!pool) {
+        pool = QThreadPool::globalInstance();
+    }
+
+    pool->start(task);
+
+    return future;
+}
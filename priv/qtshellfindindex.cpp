@@ -0,0 +1,281 @@
+#include <QHash>
+#include <QFile>
+#include <QDebug>
+#include <QMutex>
+#include <QDateTime>
+#include "qtshell.h"
+#include "priv/qtshellfind.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace QtShell;
+using namespace QtShell::Private;
+
+#ifdef Q_OS_LINUX
+static const uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                   IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+#endif
+
+class QtShell::FindIndex::Data {
+public:
+
+    class CachedDir {
+    public:
+        QList<DirEntry> entries;
+
+        // The inotify watch descriptor. -1 if it is not watched
+        int wd;
+
+        // Only used if the directory is not watched
+        QDateTime lastModified;
+    };
+
+    Data() : fd(-1) {
+    }
+
+    /// Return the cached listing of a directory, or read and cache it
+    bool list(const QString& path, QList<DirEntry>& entries);
+
+    /// Read the pending inotify events and drop the directories changed
+    void sync();
+
+    /// Drop a cached directory. If recursive is true, all the directories inside are dropped too.
+    void remove(const QString& path, bool recursive);
+
+    /// Detach a path from its watch. The watch is removed with its last path
+    void unwatch(int wd, const QString& path);
+
+    QString root;
+    QMutex mutex;
+    QHash<QString, CachedDir> dirs;
+    // inotify returns the same wd for the same directory, so a directory reached by links has a path per alias
+    QHash<int, QStringList> watches;
+    int fd;
+};
+
+bool QtShell::FindIndex::Data::list(const QString &path, QList<DirEntry> &entries)
+{
+    QHash<QString, CachedDir>::const_iterator iter = dirs.constFind(path);
+
+    if (iter != dirs.constEnd()) {
+        if (iter->wd >= 0 || QFileInfo(path).lastModified() == iter->lastModified) {
+            entries = iter->entries;
+            return true;
+        }
+    }
+
+    CachedDir dir;
+    dir.wd = -1;
+
+#ifdef Q_OS_LINUX
+    // Watch before reading, so that a change made during the listing is not missed
+    if (fd >= 0) {
+        dir.wd = inotify_add_watch(fd, QFile::encodeName(path).constData(), WATCH_MASK);
+        if (dir.wd >= 0) {
+            QStringList& paths = watches[dir.wd];
+            if (!paths.contains(path)) {
+                paths << path;
+            }
+        }
+    }
+#endif
+
+    if (dir.wd < 0) {
+        dir.lastModified = QFileInfo(path).lastModified();
+    }
+
+    if (!readDir(path, dir.entries, true)) {
+        unwatch(dir.wd, path);
+        dirs.remove(path);
+        return false;
+    }
+
+    // Do not keep the stat data. The size and time predicates should get the latest value.
+    for (int i = 0 ; i < dir.entries.size() ; i++) {
+        dir.entries[i].info = QFileInfo();
+    }
+
+    entries = dir.entries;
+    dirs[path] = dir;
+    return true;
+}
+
+void QtShell::FindIndex::Data::sync()
+{
+#ifdef Q_OS_LINUX
+    if (fd < 0) {
+        return;
+    }
+
+    alignas(struct inotify_event) char buffer[4096];
+
+    forever {
+        ssize_t length = ::read(fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+
+        const char* ptr = buffer;
+        while (ptr < buffer + length) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Some events are lost. Nothing could be trusted
+                QHash<int, QStringList>::const_iterator iter;
+                for (iter = watches.constBegin() ; iter != watches.constEnd() ; iter++) {
+                    inotify_rm_watch(fd, iter.key());
+                }
+                watches.clear();
+                dirs.clear();
+                continue;
+            }
+
+            if (!watches.contains(event->wd)) {
+                continue;
+            }
+
+            // Every alias of the directory is dropped
+            QStringList paths = watches.value(event->wd);
+
+            if (event->mask & IN_IGNORED) {
+                watches.remove(event->wd);
+            }
+
+            foreach (QString path, paths) {
+                if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    remove(path, true);
+                    continue;
+                }
+
+                if ((event->mask & IN_ISDIR) && (event->mask & (IN_DELETE | IN_MOVED_FROM)) && event->len > 0) {
+                    remove(joinPath(path, QFile::decodeName(event->name)), true);
+                }
+
+                remove(path, false);
+            }
+        }
+    }
+#endif
+}
+
+void QtShell::FindIndex::Data::remove(const QString &path, bool recursive)
+{
+    if (dirs.contains(path)) {
+        unwatch(dirs.value(path).wd, path);
+        dirs.remove(path);
+    }
+
+    if (!recursive) {
+        return;
+    }
+
+    QString prefix = joinPath(path, "");
+    QHash<QString, CachedDir>::iterator iter = dirs.begin();
+
+    while (iter != dirs.end()) {
+        if (iter.key().startsWith(prefix)) {
+            unwatch(iter->wd, iter.key());
+            iter = dirs.erase(iter);
+        } else {
+            iter++;
+        }
+    }
+}
+
+void QtShell::FindIndex::Data::unwatch(int wd, const QString& path)
+{
+#ifdef Q_OS_LINUX
+    if (wd < 0 || !watches.contains(wd)) {
+        return;
+    }
+
+    QStringList& paths = watches[wd];
+    paths.removeAll(path);
+
+    if (paths.isEmpty()) {
+        watches.remove(wd);
+        inotify_rm_watch(fd, wd);
+    }
+#else
+    Q_UNUSED(wd);
+    Q_UNUSED(path);
+#endif
+}
+
+QtShell::FindIndex::FindIndex(const QString &root) : d(new Data())
+{
+    d->root = root;
+
+#ifdef Q_OS_LINUX
+    d->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (d->fd < 0) {
+        qWarning() << "FindIndex: inotify is not available. Fall back to check the modification time";
+    }
+#endif
+}
+
+QtShell::FindIndex::~FindIndex()
+{
+#ifdef Q_OS_LINUX
+    if (d->fd >= 0) {
+        ::close(d->fd);
+    }
+#endif
+    delete d;
+}
+
+QString QtShell::FindIndex::root() const
+{
+    return d->root;
+}
+
+QStringList QtShell::FindIndex::find(const FindOptions &options, const QStringList &nameFilters)
+{
+    QStringList result;
+
+    find(options, nameFilters, [&](const FindEntry& entry) {
+        result << entry.path;
+        return FindContinue;
+    });
+
+    return result;
+}
+
+QStringList QtShell::FindIndex::find(const QStringList &nameFilters)
+{
+    FindOptions options;
+    return find(options, nameFilters);
+}
+
+bool QtShell::FindIndex::find(const FindOptions &options, const QStringList &nameFilters, const FindVisitor &visitor)
+{
+    QMutexLocker locker(&d->mutex);
+    d->sync();
+
+    // The cache is not shared with worker threads. It is fast enough to serve from memory on the calling thread.
+    FindOptions indexOptions = options;
+    indexOptions.threads = 1;
+
+    Data* data = d;
+    FindWalker walker(indexOptions, d->root, GlobMatcher(nameFilters));
+    walker.setLister([data](const QString& path, QList<DirEntry>& entries) {
+        return data->list(path, entries);
+    });
+
+    return walker.run(visitor);
+}
+
+void QtShell::FindIndex::clear()
+{
+    QMutexLocker locker(&d->mutex);
+    d->sync();
+
+    QStringList paths = d->dirs.keys();
+    for (int i = 0 ; i < paths.size() ; i++) {
+        d->remove(paths[i], false);
+    }
+}
@@ -0,0 +1,126 @@
+#include <string.h>
+#include "qtshell.h"
+
+QtShell::FindResult::FindResult() : m_rootSeparator(true)
+{
+}
+
+int QtShell::FindResult::size() const
+{
+    return m_items.size();
+}
+
+bool QtShell::FindResult::isEmpty() const
+{
+    return m_items.isEmpty();
+}
+
+QString QtShell::FindResult::at(int index) const
+{
+    return path(m_items.at(index));
+}
+
+QString QtShell::FindResult::fileName(int index) const
+{
+    const Node& node = m_nodes.at(m_items.at(index));
+    return m_names.mid(node.offset, node.length);
+}
+
+QStringList QtShell::FindResult::toStringList() const
+{
+    QStringList result;
+    result.reserve(m_items.size());
+
+    // Entries of the same directory are stored next to each other. Reuse the path of the last directory
+    int lastParent = -1;
+    QString parentPath;
+
+    for (int i = 0 ; i < m_items.size() ; i++) {
+        int index = m_items.at(i);
+        const Node& node = m_nodes.at(index);
+
+        if (node.parent < 0) {
+            result << m_root;
+            continue;
+        }
+
+        if (node.parent != lastParent) {
+            lastParent = node.parent;
+            parentPath = path(node.parent);
+        }
+
+        QString item;
+        item.reserve(parentPath.size() + 1 + node.length);
+        item.append(parentPath);
+        if (node.parent != 0 || m_rootSeparator) {
+            item.append(QChar('/'));
+        }
+        item.append(m_names.constData() + node.offset, node.length);
+        result << item;
+    }
+
+    return result;
+}
+
+void QtShell::FindResult::clear()
+{
+    m_root.clear();
+    m_rootSeparator = true;
+    m_names.clear();
+    m_nodes.clear();
+    m_items.clear();
+}
+
+int QtShell::FindResult::append(int parent, const QString &name, bool matched)
+{
+    Node node;
+    node.parent = parent;
+    node.offset = m_names.size();
+    node.length = name.size();
+
+    m_names.append(name);
+
+    int index = m_nodes.size();
+    m_nodes.append(node);
+
+    if (matched) {
+        m_items.append(index);
+    }
+
+    return index;
+}
+
+QString QtShell::FindResult::path(int index) const
+{
+    // Measure the length first, then fill the path from its end
+    int length = m_root.size();
+    int current = index;
+
+    while (current > 0) {
+        const Node& node = m_nodes.at(current);
+        length += node.length;
+        if (node.parent != 0 || m_rootSeparator) {
+            length++;
+        }
+        current = node.parent;
+    }
+
+    QString res(length, Qt::Uninitialized);
+    QChar* data = res.data();
+    QChar* out = data + length;
+    current = index;
+
+    while (current > 0) {
+        const Node& node = m_nodes.at(current);
+        out -= node.length;
+        memcpy(out, m_names.constData() + node.offset, node.length * sizeof(QChar));
+        if (node.parent != 0 || m_rootSeparator) {
+            *(--out) = QChar('/');
+        }
+        current = node.parent;
+    }
+
+    memcpy(data, m_root.constData(), m_root.size() * sizeof(QChar));
+
+    return res;
+}
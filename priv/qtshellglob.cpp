@@ -0,0 +1,302 @@
+#include <QVector>
+#include "qtshell.h"
+
+class QtShell::GlobMatcher::Data {
+public:
+
+    class Token {
+    public:
+        enum Type {
+            Char,
+            AnyChar,
+            Star,
+            Set
+        };
+
+        Type type;
+        QChar ch;
+
+        // Set only. The ranges are stored in Pattern::ranges[from] ... ranges[from + count - 1]
+        int from;
+        int count;
+        bool negated;
+    };
+
+    class Pattern {
+    public:
+        enum Kind {
+            Everything, // "*"
+            Literal,    // "name.txt"
+            Suffix,     // "*.txt"
+            Prefix,     // "name*"
+            Wildcard    // Anything else. Matched by the token program
+        };
+
+        Kind kind;
+        QString text;
+        QVector<Token> tokens;
+        QVector<QPair<QChar, QChar> > ranges;
+    };
+
+    QStringList patterns;
+    QVector<Pattern> compiled;
+    Qt::CaseSensitivity cs;
+
+    Pattern compile(const QString& pattern) const;
+
+    bool match(const Pattern& pattern, const QString& fileName) const;
+
+    bool matchWildcard(const Pattern& pattern, const QChar* str, int length) const;
+
+    bool matchSet(const Pattern& pattern, const Token& token, QChar c) const;
+};
+
+QtShell::GlobMatcher::Data::Pattern QtShell::GlobMatcher::Data::compile(const QString &pattern) const
+{
+    Pattern res;
+    int i = 0;
+    int length = pattern.size();
+
+    while (i < length) {
+        QChar c = pattern.at(i++);
+        Token token;
+        token.type = Token::Char;
+        token.ch = c;
+        token.from = 0;
+        token.count = 0;
+        token.negated = false;
+
+        if (c == QChar('*')) {
+            token.type = Token::Star;
+            // "**" is same as "*"
+            if (res.tokens.size() > 0 && res.tokens.last().type == Token::Star) {
+                continue;
+            }
+        } else if (c == QChar('?')) {
+            token.type = Token::AnyChar;
+        } else if (c == QChar('[')) {
+            // Same as QRegExp::Wildcard: "[^...]" is a negated set and a "]" right after "[" or "[^" is a member.
+            int j = i;
+            bool negated = false;
+            if (j < length && pattern.at(j) == QChar('^')) {
+                negated = true;
+                j++;
+            }
+
+            int from = res.ranges.size();
+            bool first = true;
+
+            while (j < length && (first || pattern.at(j) != QChar(']'))) {
+                QChar lower = pattern.at(j);
+                QChar upper = lower;
+                if (j + 2 < length && pattern.at(j + 1) == QChar('-') && pattern.at(j + 2) != QChar(']')) {
+                    upper = pattern.at(j + 2);
+                    j += 2;
+                }
+                res.ranges << QPair<QChar, QChar>(lower, upper);
+                j++;
+                first = false;
+            }
+
+            if (j < length) {
+                token.type = Token::Set;
+                token.from = from;
+                token.count = res.ranges.size() - from;
+                token.negated = negated;
+                i = j + 1;
+            } else {
+                // Unterminated set. Take the "[" as a normal character
+                res.ranges.resize(from);
+            }
+        }
+
+        if (token.type == Token::Char && cs == Qt::CaseInsensitive) {
+            token.ch = token.ch.toCaseFolded();
+        }
+
+        res.tokens << token;
+    }
+
+    // Pick a fast path if the pattern contains nothing but characters and at most one leading or trailing "*"
+    int stars = 0;
+    int others = 0;
+    for (int j = 0 ; j < res.tokens.size() ; j++) {
+        if (res.tokens[j].type == Token::Star) {
+            stars++;
+        } else if (res.tokens[j].type != Token::Char) {
+            others++;
+        }
+    }
+
+    res.kind = Pattern::Wildcard;
+
+    if (others == 0) {
+        int size = res.tokens.size();
+        if (stars == 0) {
+            res.kind = Pattern::Literal;
+            res.text = pattern;
+        } else if (stars == 1 && size == 1) {
+            res.kind = Pattern::Everything;
+        } else if (stars == 1 && res.tokens.first().type == Token::Star) {
+            res.kind = Pattern::Suffix;
+            res.text = pattern.mid(pattern.lastIndexOf(QChar('*')) + 1);
+        } else if (stars == 1 && res.tokens.last().type == Token::Star) {
+            res.kind = Pattern::Prefix;
+            res.text = pattern.left(pattern.indexOf(QChar('*')));
+        }
+    }
+
+    if (res.kind != Pattern::Wildcard) {
+        res.tokens.clear();
+    }
+
+    return res;
+}
+
+bool QtShell::GlobMatcher::Data::match(const Pattern &pattern, const QString &fileName) const
+{
+    switch (pattern.kind) {
+    case Pattern::Everything:
+        return true;
+    case Pattern::Literal:
+        return fileName.compare(pattern.text, cs) == 0;
+    case Pattern::Suffix:
+        return fileName.endsWith(pattern.text, cs);
+    case Pattern::Prefix:
+        return fileName.startsWith(pattern.text, cs);
+    case Pattern::Wildcard:
+        break;
+    }
+
+    return matchWildcard(pattern, fileName.constData(), fileName.size());
+}
+
+bool QtShell::GlobMatcher::Data::matchWildcard(const Pattern &pattern, const QChar *str, int length) const
+{
+    // Iterative matching with a single backtrack point at the last "*". No allocation.
+    const Token* tokens = pattern.tokens.constData();
+    int count = pattern.tokens.size();
+    int t = 0;
+    int i = 0;
+    int starToken = -1;
+    int starPos = 0;
+
+    while (i < length) {
+        if (t < count) {
+            const Token& token = tokens[t];
+            bool res = false;
+
+            switch (token.type) {
+            case Token::Star:
+                starToken = t++;
+                starPos = i;
+                continue;
+            case Token::AnyChar:
+                res = true;
+                break;
+            case Token::Char:
+                res = cs == Qt::CaseInsensitive ? str[i].toCaseFolded() == token.ch : str[i] == token.ch;
+                break;
+            case Token::Set:
+                res = matchSet(pattern, token, str[i]);
+                break;
+            }
+
+            if (res) {
+                t++;
+                i++;
+                continue;
+            }
+        }
+
+        if (starToken < 0) {
+            return false;
+        }
+
+        t = starToken + 1;
+        i = ++starPos;
+    }
+
+    while (t < count && tokens[t].type == Token::Star) {
+        t++;
+    }
+
+    return t == count;
+}
+
+bool QtShell::GlobMatcher::Data::matchSet(const Pattern &pattern, const Token &token, QChar c) const
+{
+    bool res = false;
+    const QPair<QChar, QChar>* ranges = pattern.ranges.constData() + token.from;
+
+    for (int i = 0 ; i < token.count && !res ; i++) {
+        const QPair<QChar, QChar>& range = ranges[i];
+        res = c >= range.first && c <= range.second;
+
+        if (!res && cs == Qt::CaseInsensitive) {
+            QChar lower = c.toLower();
+            QChar upper = c.toUpper();
+            res = (lower >= range.first && lower <= range.second) ||
+                  (upper >= range.first && upper <= range.second);
+        }
+    }
+
+    return res != token.negated;
+}
+
+QtShell::GlobMatcher::GlobMatcher()
+{
+}
+
+QtShell::GlobMatcher::GlobMatcher(const QString &pattern, Qt::CaseSensitivity cs)
+{
+    Data* data = new Data();
+    data->cs = cs;
+    data->patterns << pattern;
+    data->compiled << data->compile(pattern);
+    d = QSharedPointer<const Data>(data);
+}
+
+QtShell::GlobMatcher::GlobMatcher(const QStringList &patterns, Qt::CaseSensitivity cs)
+{
+    if (patterns.isEmpty()) {
+        return;
+    }
+
+    Data* data = new Data();
+    data->cs = cs;
+    data->patterns = patterns;
+    for (int i = 0 ; i < patterns.size() ; i++) {
+        data->compiled << data->compile(patterns[i]);
+    }
+    d = QSharedPointer<const Data>(data);
+}
+
+bool QtShell::GlobMatcher::isEmpty() const
+{
+    return d.isNull();
+}
+
+QStringList QtShell::GlobMatcher::patterns() const
+{
+    if (d.isNull()) {
+        return QStringList();
+    }
+
+    return d->patterns;
+}
+
+bool QtShell::GlobMatcher::match(const QString &fileName) const
+{
+    if (d.isNull()) {
+        return true;
+    }
+
+    for (int i = 0 ; i < d->compiled.size() ; i++) {
+        if (d->match(d->compiled.at(i), fileName)) {
+            return true;
+        }
+    }
+
+    return false;
+}
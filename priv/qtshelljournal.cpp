@@ -0,0 +1,282 @@
+#include <QFile>
+#include <QDebug>
+#include "qtshell.h"
+
+using namespace QtShell;
+
+// Write the buffer to the file when it grows beyond this size
+static const int FLUSH_SIZE = 64 * 1024;
+
+QtShell::Journal::~Journal()
+{
+}
+
+QtShell::MemoryJournal::MemoryJournal()
+{
+}
+
+void QtShell::MemoryJournal::append(const QString &source, const QString &target)
+{
+    int sourceSplit = source.lastIndexOf(QChar('/'));
+    int targetSplit = target.lastIndexOf(QChar('/'));
+
+    QStringRef sourceName = source.midRef(sourceSplit + 1);
+    QStringRef targetName = target.midRef(targetSplit + 1);
+
+    Entry entry;
+    entry.sourceDir = sourceSplit < 0 ? -1 : intern(source.left(sourceSplit));
+    entry.targetDir = targetSplit < 0 ? -1 : intern(target.left(targetSplit));
+    entry.offset = m_names.size();
+    entry.sourceLength = sourceName.size();
+    entry.targetLength = -1;
+
+    m_names.append(sourceName);
+
+    if (targetName != sourceName) {
+        entry.targetLength = targetName.size();
+        m_names.append(targetName);
+    }
+
+    m_entries << entry;
+}
+
+int QtShell::MemoryJournal::size() const
+{
+    return m_entries.size();
+}
+
+bool QtShell::MemoryJournal::isEmpty() const
+{
+    return m_entries.isEmpty();
+}
+
+QPair<QString, QString> QtShell::MemoryJournal::at(int index) const
+{
+    const Entry& entry = m_entries.at(index);
+
+    QString source = join(entry.sourceDir, entry.offset, entry.sourceLength);
+    QString target = entry.targetLength < 0 ? join(entry.targetDir, entry.offset, entry.sourceLength) :
+                                              join(entry.targetDir, entry.offset + entry.sourceLength, entry.targetLength);
+
+    return QPair<QString,QString>(source, target);
+}
+
+QList<QPair<QString, QString> > QtShell::MemoryJournal::toList() const
+{
+    QList<QPair<QString, QString> > result;
+    result.reserve(m_entries.size());
+
+    for (int i = 0 ; i < m_entries.size() ; i++) {
+        result << at(i);
+    }
+
+    return result;
+}
+
+void QtShell::MemoryJournal::clear()
+{
+    m_dirs.clear();
+    m_dirIndex.clear();
+    m_names.clear();
+    m_entries.clear();
+}
+
+int QtShell::MemoryJournal::intern(const QString &dir)
+{
+    // Files of a directory are usually appended one after another
+    if (!m_dirs.isEmpty() && m_dirs.last() == dir) {
+        return m_dirs.size() - 1;
+    }
+
+    QHash<QString, int>::const_iterator iter = m_dirIndex.constFind(dir);
+    if (iter != m_dirIndex.constEnd()) {
+        return iter.value();
+    }
+
+    int index = m_dirs.size();
+    m_dirs << dir;
+    m_dirIndex[dir] = index;
+    return index;
+}
+
+QString QtShell::MemoryJournal::join(int dir, int offset, int length) const
+{
+    if (dir < 0) {
+        return m_names.mid(offset, length);
+    }
+
+    const QString& dirPath = m_dirs.at(dir);
+
+    QString res;
+    res.reserve(dirPath.size() + 1 + length);
+    res.append(dirPath);
+    res.append(QChar('/'));
+    res.append(m_names.constData() + offset, length);
+    return res;
+}
+
+class QtShell::FileJournal::Data {
+public:
+    Data() : error(false) {
+    }
+
+    QFile file;
+    QByteArray buffer;
+    // A record is dropped
+    bool error;
+};
+
+static void escape(const QString& path, QByteArray& output) {
+    QByteArray bytes = path.toUtf8();
+
+    for (int i = 0 ; i < bytes.size() ; i++) {
+        char c = bytes.at(i);
+        switch (c) {
+        case '\\':
+            output.append("\\\\");
+            break;
+        case '\t':
+            output.append("\\t");
+            break;
+        case '\n':
+            output.append("\\n");
+            break;
+        default:
+            output.append(c);
+            break;
+        }
+    }
+}
+
+static QString unescape(const QByteArray& input) {
+    QByteArray bytes;
+    bytes.reserve(input.size());
+
+    for (int i = 0 ; i < input.size() ; i++) {
+        char c = input.at(i);
+        if (c == '\\' && i + 1 < input.size()) {
+            char next = input.at(++i);
+            c = next == 't' ? '\t' : next == 'n' ? '\n' : next;
+        }
+        bytes.append(c);
+    }
+
+    return QString::fromUtf8(bytes);
+}
+
+QtShell::FileJournal::FileJournal(const QString &fileName) : d(new Data())
+{
+    d->file.setFileName(fileName);
+}
+
+QtShell::FileJournal::~FileJournal()
+{
+    close();
+    delete d;
+}
+
+QString QtShell::FileJournal::fileName() const
+{
+    return d->file.fileName();
+}
+
+bool QtShell::FileJournal::open()
+{
+    if (d->file.isOpen()) {
+        return true;
+    }
+
+    if (!d->file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << QString("FileJournal: %1: %2").arg(d->file.fileName()).arg(d->file.errorString());
+        return false;
+    }
+
+    return true;
+}
+
+bool QtShell::FileJournal::isOpen() const
+{
+    return d->file.isOpen();
+}
+
+void QtShell::FileJournal::append(const QString &source, const QString &target)
+{
+    if (!d->file.isOpen() && !open()) {
+        // open() has warned
+        d->error = true;
+        return;
+    }
+
+    escape(source, d->buffer);
+    d->buffer.append('\t');
+    escape(target, d->buffer);
+    d->buffer.append('\n');
+
+    if (d->buffer.size() >= FLUSH_SIZE) {
+        flush();
+    }
+}
+
+bool QtShell::FileJournal::flush()
+{
+    if (!d->file.isOpen()) {
+        return d->buffer.isEmpty();
+    }
+
+    bool res = true;
+
+    if (!d->buffer.isEmpty()) {
+        res = d->file.write(d->buffer) == d->buffer.size();
+        d->buffer.clear();
+    }
+
+    res = d->file.flush() && res;
+
+    if (!res) {
+        qWarning() << QString("FileJournal: %1: %2").arg(d->file.fileName()).arg(d->file.errorString());
+        d->error = true;
+    }
+
+    return res;
+}
+
+bool QtShell::FileJournal::hasError() const
+{
+    return d->error;
+}
+
+void QtShell::FileJournal::close()
+{
+    if (d->file.isOpen()) {
+        flush();
+        d->file.close();
+    }
+}
+
+bool QtShell::FileJournal::replay(const QString &fileName, const Replayer& replayer)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+
+        // A record without the line break was not completely written
+        if (!line.endsWith('\n')) {
+            break;
+        }
+        line.chop(1);
+
+        int separator = line.indexOf('\t');
+        if (separator < 0) {
+            continue;
+        }
+
+        replayer(unescape(line.left(separator)), unescape(line.mid(separator + 1)));
+    }
+
+    return true;
+}
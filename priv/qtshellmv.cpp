@@ -1,28 +1,393 @@
+#include <QStorageInfo>
 #include "qtshell.h"
 #include "priv/qtshellpriv.h"
+#include "priv/qtshellprogress.h"
+#include "priv/qtshellcopy.h"
+#include "priv/qtshellpool.h"
+#include "priv/qtshelldirent.h"
 
+#ifdef Q_OS_UNIX
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+
+#ifndef RENAME_NOREPLACE
+#define RENAME_NOREPLACE (1 << 0)
+#endif
+#endif
+
+using namespace QtShell;
 using namespace QtShell::Private;
 
-static bool _mv(const QString &source, const QString &target, QList<QPair<QString,QString> > &log) {
+namespace {
+
+    /// Move a file hierarchy to another file system: copy everything, then remove the source.
+    /// Files are copied by the kernel side engine of cp on a pool of workers. Directories and symbolic links are created
+    /// on the calling thread. The source is only removed if every entry is copied and verified.
+    class CrossDeviceMove {
+    public:
+        CrossDeviceMove() : pool(0), failed(0), created(0) {
+        }
+
+        ~CrossDeviceMove() {
+            delete pool;
+        }
+
+        bool move(const QString& from, const QString& to);
+
+    private:
+        bool copy(const QString& from, const QString& to);
+
+        void copyFile(const QString& from, const QString& to);
+
+        WorkStealingPool* pool;
+        QAtomicInt failed;
+
+        // The target of move(). Only the entry created there by this move is removed on failure
+        QString target;
+        QAtomicInt created;
+
+        // Directories get their metadata after their content is written
+        QList<QPair<QString, QString> > dirs;
+    };
+
+}
+
+static bool removeEntry(const QString& path) {
+    QFileInfo info(path);
+    if (info.isDir() && !info.isSymLink()) {
+        return QDir(path).removeRecursively();
+    }
+    return QFile::remove(path);
+}
+
+bool CrossDeviceMove::move(const QString &from, const QString &to)
+{
+    // Same as rename with RENAME_NOREPLACE, an existing target is never touched
+    QFileInfo toInfo(to);
+    if (toInfo.exists() || toInfo.isSymLink()) {
+        qWarning() << QString("mv: %1: The target %2 already exists").arg(from).arg(to);
+        return false;
+    }
+
+    target = to;
+    bool res = copy(from, to);
+
+    if (pool) {
+        pool->waitForDone();
+    }
+
+    res = res && failed.load() == 0;
+
+    // Deepest first, so a directory is not changed again after its times are set
+    for (int i = dirs.size() - 1 ; i >= 0 && res ; i--) {
+        res = copyMetadata(dirs[i].first, dirs[i].second);
+    }
+
+    if (!res) {
+        qWarning() << QString("mv: %1: Failed to copy to %2. The source is kept").arg(from).arg(to);
+        if (created.load()) {
+            removeEntry(to);
+        }
+        return false;
+    }
+
+    bool removed = removeEntry(from);
+
+    if (!removed) {
+        qWarning() << QString("mv: %1: Failed to remove the source after copying").arg(from);
+    }
+
+    return removed;
+}
+
+bool CrossDeviceMove::copy(const QString &from, const QString &to)
+{
+    QFileInfo info(from);
+
+    if (info.isSymLink()) {
+#ifdef Q_OS_UNIX
+        // Keep the link target as it is. QFileInfo::symLinkTarget() would make it absolute
+        char buffer[PATH_MAX];
+        ssize_t length = ::readlink(QFile::encodeName(from).constData(), buffer, sizeof(buffer));
+        if (length < 0 || length == (ssize_t) sizeof(buffer)) {
+            return false;
+        }
+
+        if (::symlink(QByteArray(buffer, length).constData(), QFile::encodeName(to).constData()) != 0) {
+            return false;
+        }
+#else
+        if (!QFile::link(info.symLinkTarget(), to)) {
+            return false;
+        }
+#endif
+        if (to == target) {
+            created.store(1);
+        }
+#ifdef Q_OS_UNIX
+        return copyMetadata(from, to);
+#else
+        return true;
+#endif
+    }
+
+    if (info.isFile()) {
+        if (!pool) {
+            // A single file. No need of threads
+            copyFile(from, to);
+            return true;
+        }
+
+        pool->submit([=]() {
+            copyFile(from, to);
+        });
+        return true;
+    }
+
+    if (!info.isDir()) {
+        qWarning() << QString("mv: %1: Could not move a special file across file systems").arg(from);
+        return false;
+    }
+
+    if (!QDir().mkdir(to)) {
+        return false;
+    }
+
+    if (to == target) {
+        created.store(1);
+    }
+
+    dirs << QPair<QString, QString>(from, to);
+
+    if (!pool) {
+        pool = new WorkStealingPool(WorkStealingPool::resolveThreadCount(0));
+    }
+
+    QFileInfoList infos = QDir(from).entryInfoList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+
+    for (int i = 0 ; i < infos.size() ; i++) {
+        if (!copy(infos[i].filePath(), to + "/" + infos[i].fileName())) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void CrossDeviceMove::copyFile(const QString &from, const QString &to)
+{
+    bool res = QtShell::Private::copyFile(from, to);
+
+    // copyFile() does not overwrite, and it removes its own partial file on failure
+    if (res && to == target) {
+        created.store(1);
+    }
+
+    res = res && copyMetadata(from, to);
+
+    // Verify by size. The data has gone through the kernel and close() succeeded
+    res = res && QFileInfo(from).size() == QFileInfo(to).size();
+
+    if (!res) {
+        failed.ref();
+    }
+}
+
+// The rename failed. Check whether it is because the target is on another file system
+static bool isCrossDevice(const QString& from, const QString& to) {
+    QString targetDir = QtShell::dirname(to);
+
+#ifdef Q_OS_UNIX
+    struct stat source;
+    struct stat target;
+
+    if (::lstat(QFile::encodeName(from).constData(), &source) != 0 ||
+        ::stat(QFile::encodeName(targetDir).constData(), &target) != 0) {
+        return false;
+    }
+
+    return source.st_dev != target.st_dev;
+#else
+    QStorageInfo source(from);
+    QStorageInfo target(targetDir);
+    return source.isValid() && target.isValid() && source.rootPath() != target.rootPath();
+#endif
+}
+
+#ifdef Q_OS_LINUX
+
+// The result of renameBatch() if it could not handle the call
+static const int NOT_HANDLED = 1;
+
+// Rename without replacing an existing target, same as QDir::rename()
+static int renameNoReplace(int fromDir, const char* from, int toDir, const char* to) {
+#ifdef SYS_renameat2
+    // Call by syscall(), it is not available in glibc < 2.28
+    if (syscall(SYS_renameat2, fromDir, from, toDir, to, RENAME_NOREPLACE) == 0) {
+        return 0;
+    }
+
+    if (errno != ENOSYS && errno != EINVAL) {
+        return -1;
+    }
+#endif
+
+    struct stat st;
+    if (fstatat(toDir, to, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        errno = EEXIST;
+        return -1;
+    }
+
+    return renameat(fromDir, from, toDir, to);
+}
+
+// Move the entries matched by a wildcard (e.g "/data/spool/*.part") into a directory. Both directories are opened once and each
+// entry is renamed by its name relative to the directory fds, so the kernel does not resolve the full paths again for every file.
+// It returns NOT_HANDLED if the source is not a wildcard or the target is not a directory, then bulk() should be used.
+static int renameBatch(const QString &source, const QString &target, Journal &journal, const ProgressTracker& tracker) {
+    QString s = normalize(source);
+    QString t = normalize(target);
+    QString folder = QtShell::dirname(s);
+    QString filter = QtShell::basename(s);
+
+    if (s.startsWith(QChar(':')) || filter.indexOf(QRegExp("[*?\\[]")) < 0 || !QFileInfo(t).isDir()) {
+        return NOT_HANDLED;
+    }
+
+    // Same filter and order as QDir::entryInfoList() in bulk()
+    QList<DirEntry> entries;
+    if (!readDir(folder, entries)) {
+        return NO_SUCH_FILE_OR_DIR;
+    }
+
+    GlobMatcher matcher(filter);
+    QList<QByteArray> names;
+    for (int i = 0 ; i < entries.size() ; i++) {
+        if (matcher.match(entries[i].name)) {
+            names << QFile::encodeName(entries[i].name);
+        }
+    }
+
+    if (names.isEmpty()) {
+        return NO_SUCH_FILE_OR_DIR;
+    }
+
+    int fromDir = ::open(QFile::encodeName(folder).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    int toDir = ::open(QFile::encodeName(t).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fromDir < 0 || toDir < 0) {
+        if (fromDir >= 0) {
+            ::close(fromDir);
+        }
+        if (toDir >= 0) {
+            ::close(toDir);
+        }
+        return NOT_HANDLED;
+    }
+
+    bool unexceptedError = false;
+
+    for (int i = 0 ; i < names.size() ; i++) {
+        const QByteArray& name = names.at(i);
+        QString from = folder + "/" + QFile::decodeName(name);
+        QString to = t + "/" + QFile::decodeName(name);
+
+        journal.append(from, to);
+
+        bool renamed = renameNoReplace(fromDir, name.constData(), toDir, name.constData()) == 0;
+
+        // renameat2() reports EXDEV before it checks the target. An existing target is a failure, same as RENAME_NOREPLACE
+        struct stat st;
+        if (!renamed && errno == EXDEV && fstatat(toDir, name.constData(), &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            CrossDeviceMove move;
+            renamed = move.move(from, to);
+        }
+
+        tracker.add(1, 0);
+        unexceptedError = !renamed || unexceptedError;
+    }
+
+    ::close(fromDir);
+    ::close(toDir);
+
+    return unexceptedError ? UNEXCEPTED_ERROR : NO_ERROR;
+}
+
+#endif
+
+static bool _mv(const QString &source, const QString &target, Journal &journal, Progress* progress = 0) {
     if (source.isEmpty() || target.isEmpty()) {
         qWarning() << "usage: mv(source, target)";
         return false;
     }
 
-    return QtShell::Private::bulk(source, target, [&](const QString& from , const QString& to, const QFileInfo& fromInfo){
+    ProgressTracker tracker(progress);
+
+    if (tracker.scan()) {
+        qint64 files = 0;
+        tracker.startScan();
+        QtShell::Private::bulk(source, target, [&](const QString&, const QString&, const QFileInfo&) {
+            files++;
+            return true;
+        });
+        // A rename moves no data
+        tracker.setTotal(files, 0);
+    }
+
+    tracker.startTransfer();
+
+#ifdef Q_OS_LINUX
+    int code = renameBatch(source, target, journal, tracker);
+    if (code != NOT_HANDLED) {
+        tracker.finish();
+        return code;
+    }
+#endif
+
+    int res = QtShell::Private::bulk(source, target, [&](const QString& from , const QString& to, const QFileInfo& fromInfo){
         Q_UNUSED(fromInfo);
 
         QDir dir;
-        log << QPair<QString,QString>(from, to);
-        return dir.rename(from, to);
+        journal.append(from, to);
+        bool renamed = dir.rename(from, to);
+
+        if (!renamed && !QFileInfo::exists(to) && isCrossDevice(from, to)) {
+            CrossDeviceMove move;
+            renamed = move.move(from, to);
+        }
+
+        tracker.add(1, 0);
+        return renamed;
     });
+
+    tracker.finish();
+
+    return res;
 }
 
 bool QtShell::mv(const QString &source, const QString &target) {
-    QList<QPair<QString,QString> > log;
-    return _mv(source, target, log) == NO_ERROR;
+    NullJournal journal;
+    return _mv(source, target, journal) == NO_ERROR;
 }
 
 bool QtShell::mv(const QString &source, const QString &target, QList<QPair<QString,QString> > &log) {
-    return _mv(source, target, log) == NO_ERROR;
+    LogJournal journal(log);
+    return _mv(source, target, journal) == NO_ERROR;
+}
+
+bool QtShell::mv(const QString &source, const QString &target, Journal &journal) {
+    return _mv(source, target, journal) == NO_ERROR;
+}
+
+bool QtShell::mv(const QString &source, const QString &target, Progress &progress) {
+    NullJournal journal;
+    return _mv(source, target, journal, &progress) == NO_ERROR;
 }
@@ -0,0 +1,180 @@
+#include "qtshellpool.h"
+
+using namespace QtShell::Private;
+
+// The pool and the index of the worker running on the current thread
+static thread_local WorkStealingPool* currentPool = 0;
+static thread_local int currentIndex = -1;
+
+class WorkStealingPool::Worker : public QThread {
+public:
+    Worker(WorkStealingPool* pool, int index) : pool(pool), index(index) {
+    }
+
+protected:
+    void run() override {
+        pool->run(index);
+    }
+
+private:
+    WorkStealingPool* pool;
+    int index;
+};
+
+WorkStealingPool::WorkStealingPool(int threads) : m_stopping(false)
+{
+    int count = qMax(1, threads);
+
+    for (int i = 0 ; i < count ; i++) {
+        m_queues << new Queue();
+    }
+
+    for (int i = 0 ; i < count ; i++) {
+        Worker* worker = new Worker(this, i);
+        m_threads << worker;
+        worker->start();
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    cancel();
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wakeup.wakeAll();
+    }
+
+    for (int i = 0 ; i < m_threads.size() ; i++) {
+        m_threads[i]->wait();
+    }
+
+    qDeleteAll(m_threads);
+    qDeleteAll(m_queues);
+}
+
+void WorkStealingPool::submit(const Task &task)
+{
+    if (isCanceled()) {
+        return;
+    }
+
+    int index = 0;
+
+    if (currentPool == this) {
+        index = currentIndex;
+    } else {
+        index = (m_next.fetchAndAddRelaxed(1) & 0x7fffffff) % m_queues.size();
+    }
+
+    m_pending.ref();
+
+    Queue* queue = m_queues[index];
+    {
+        QMutexLocker locker(&queue->mutex);
+        queue->tasks.append(task);
+    }
+    m_queued.ref();
+
+    QMutexLocker locker(&m_mutex);
+    m_wakeup.wakeOne();
+}
+
+void WorkStealingPool::waitForDone()
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_pending.load() > 0) {
+        m_done.wait(&m_mutex);
+    }
+}
+
+void WorkStealingPool::cancel()
+{
+    m_canceled.store(1);
+}
+
+bool WorkStealingPool::isCanceled() const
+{
+    return m_canceled.load() != 0;
+}
+
+int WorkStealingPool::threadCount() const
+{
+    return m_threads.size();
+}
+
+int WorkStealingPool::resolveThreadCount(int threads)
+{
+    if (threads <= 0) {
+        threads = QThread::idealThreadCount();
+    }
+    return qMax(1, threads);
+}
+
+bool WorkStealingPool::take(int index, Task &task)
+{
+    Queue* own = m_queues[index];
+
+    {
+        QMutexLocker locker(&own->mutex);
+        if (!own->tasks.isEmpty()) {
+            task = own->tasks.takeLast();
+            m_queued.deref();
+            return true;
+        }
+    }
+
+    int count = m_queues.size();
+
+    for (int i = 1 ; i < count ; i++) {
+        Queue* victim = m_queues[(index + i) % count];
+        QMutexLocker locker(&victim->mutex);
+        if (!victim->tasks.isEmpty()) {
+            task = victim->tasks.takeFirst();
+            m_queued.deref();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkStealingPool::run(int index)
+{
+    currentPool = this;
+    currentIndex = index;
+
+    forever {
+        Task task;
+
+        if (!take(index, task)) {
+            QMutexLocker locker(&m_mutex);
+            if (m_stopping) {
+                break;
+            }
+            if (m_queued.load() == 0) {
+                m_wakeup.wait(&m_mutex);
+            }
+            continue;
+        }
+
+        // A canceled task is still taken out from the queue so that waitForDone() could return
+        if (!isCanceled()) {
+            task();
+        }
+
+        finish();
+    }
+
+    currentPool = 0;
+    currentIndex = -1;
+}
+
+void WorkStealingPool::finish()
+{
+    if (!m_pending.deref()) {
+        QMutexLocker locker(&m_mutex);
+        m_done.wakeAll();
+    }
+}
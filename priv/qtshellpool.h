@@ -0,0 +1,76 @@
+#ifndef QTSHELLPOOL_H
+#define QTSHELLPOOL_H
+
+#include <QList>
+#include <QVector>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QThread>
+#include <functional>
+
+namespace QtShell {
+
+    namespace Private {
+
+        /// A fixed size thread pool with one task queue per worker.
+        /// A task submitted from a worker goes to the worker's own queue and it is taken in LIFO order.
+        /// An idle worker steals the oldest task from the queue of another worker.
+        class WorkStealingPool {
+        public:
+            typedef std::function<void()> Task;
+
+            explicit WorkStealingPool(int threads);
+
+            ~WorkStealingPool();
+
+            void submit(const Task& task);
+
+            /// Block until all the submitted tasks, include the tasks submitted by them, are finished.
+            /// It must not be called from a task of the same pool.
+            void waitForDone();
+
+            /// Discard all the pending tasks. Running tasks are not interrupted.
+            void cancel();
+
+            bool isCanceled() const;
+
+            int threadCount() const;
+
+            /// Convert the value of a "threads" option to the no. of thread to be used. 0 means QThread::idealThreadCount()
+            static int resolveThreadCount(int threads);
+
+        private:
+            Q_DISABLE_COPY(WorkStealingPool)
+
+            class Worker;
+
+            class Queue {
+            public:
+                QMutex mutex;
+                QList<Task> tasks;
+            };
+
+            bool take(int index, Task& task);
+
+            void run(int index);
+
+            void finish();
+
+            QVector<Queue*> m_queues;
+            QVector<QThread*> m_threads;
+
+            QMutex m_mutex;
+            QWaitCondition m_wakeup;
+            QWaitCondition m_done;
+            bool m_stopping;
+
+            QAtomicInt m_queued;
+            QAtomicInt m_pending;
+            QAtomicInt m_next;
+            QAtomicInt m_canceled;
+        };
+    }
+}
+
+#endif // QTSHELLPOOL_H
@@ -5,6 +5,7 @@
 #include <QString>
 #include <QtCore>
 #include <functional>
+#include "qtshell.h"
 
 namespace QtShell {
 
@@ -27,6 +28,27 @@ namespace QtShell {
         } BulkError ;
 
         int bulk(const QString& source, const QString& target, std::function<bool(const QString&, const QString&, const QFileInfo&) > predicate);
+
+        /// A journal that appends to the QList log of cp and mv
+        class LogJournal : public Journal {
+        public:
+            explicit LogJournal(QList<QPair<QString,QString> > &log) : log(log) {
+            }
+
+            void append(const QString& source, const QString& target) override {
+                log << QPair<QString,QString>(source, target);
+            }
+
+        private:
+            QList<QPair<QString,QString> > &log;
+        };
+
+        /// For the calls without a log
+        class NullJournal : public Journal {
+        public:
+            void append(const QString&, const QString&) override {
+            }
+        };
     }
 }
 
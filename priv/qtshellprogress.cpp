@@ -0,0 +1,219 @@
+#include <QDir>
+#include "priv/qtshellprogress.h"
+
+using namespace QtShell;
+using namespace QtShell::Private;
+
+QtShell::ProgressInfo::ProgressInfo() : phase(Transfer), files(0), bytes(0), totalFiles(-1), totalBytes(-1),
+    elapsed(0), scanTime(0), transferTime(0), throughput(0)
+{
+}
+
+QtShell::Progress::Progress(const Callback &callback, int interval, bool scan) : d(new Data())
+{
+    d->callback = callback;
+    d->interval = interval;
+    d->scan = scan;
+    d->phase = ProgressInfo::Transfer;
+    d->totalFiles = -1;
+    d->totalBytes = -1;
+    d->scanStart = 0;
+    d->scanTime = 0;
+    d->transferStart = 0;
+    d->sequence = 0;
+    d->delivered = 0;
+}
+
+QtShell::Progress::~Progress()
+{
+    delete d;
+}
+
+int QtShell::Progress::interval() const
+{
+    return d->interval;
+}
+
+bool QtShell::Progress::scan() const
+{
+    return d->scan;
+}
+
+ProgressInfo QtShell::Progress::info() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->last;
+}
+
+ProgressTracker::ProgressTracker(Progress *progress) : d(progress ? progress->d : 0)
+{
+}
+
+void ProgressTracker::reset()
+{
+    d->timer.start();
+    d->files.store(0);
+    d->bytes.store(0);
+    d->nextReport.store(d->interval);
+    d->totalFiles = -1;
+    d->totalBytes = -1;
+    d->scanStart = 0;
+    d->scanTime = 0;
+    d->transferStart = 0;
+    d->last = ProgressInfo();
+}
+
+void ProgressTracker::startScan()
+{
+    if (!d) {
+        return;
+    }
+
+    ProgressInfo info;
+    qint64 sequence;
+    {
+        QMutexLocker locker(&d->mutex);
+        reset();
+        d->phase = ProgressInfo::Scan;
+        sequence = snapshot(info);
+    }
+    notify(info, sequence);
+}
+
+void ProgressTracker::setTotal(qint64 files, qint64 bytes)
+{
+    if (!d) {
+        return;
+    }
+
+    QMutexLocker locker(&d->mutex);
+    d->totalFiles = files;
+    d->totalBytes = bytes;
+}
+
+void ProgressTracker::startTransfer()
+{
+    if (!d) {
+        return;
+    }
+
+    ProgressInfo info;
+    qint64 sequence;
+    {
+        QMutexLocker locker(&d->mutex);
+
+        if (d->phase == ProgressInfo::Scan) {
+            d->scanTime = d->timer.elapsed() - d->scanStart;
+        } else {
+            reset();
+        }
+
+        d->phase = ProgressInfo::Transfer;
+        d->transferStart = d->timer.elapsed();
+        sequence = snapshot(info);
+    }
+    notify(info, sequence);
+}
+
+void ProgressTracker::finish()
+{
+    if (!d) {
+        return;
+    }
+
+    ProgressInfo info;
+    qint64 sequence;
+    {
+        QMutexLocker locker(&d->mutex);
+        d->phase = ProgressInfo::Finished;
+        sequence = snapshot(info);
+    }
+    notify(info, sequence);
+}
+
+void ProgressTracker::reportIfDue() const
+{
+    qint64 now = d->timer.elapsed();
+    qint64 next = d->nextReport.loadAcquire();
+
+    if (now < next) {
+        return;
+    }
+
+    // Only one thread reports. The others carry on
+    if (!d->nextReport.testAndSetOrdered(next, now + d->interval)) {
+        return;
+    }
+
+    ProgressInfo info;
+    qint64 sequence;
+    {
+        QMutexLocker locker(&d->mutex);
+        if (d->phase != ProgressInfo::Transfer) {
+            return;
+        }
+        sequence = snapshot(info);
+    }
+    notify(info, sequence);
+}
+
+qint64 ProgressTracker::snapshot(ProgressInfo &info) const
+{
+    qint64 now = d->timer.elapsed();
+
+    info.phase = d->phase;
+    info.files = d->files.load();
+    info.bytes = d->bytes.load();
+    info.totalFiles = d->totalFiles;
+    info.totalBytes = d->totalBytes;
+    info.elapsed = now;
+    info.scanTime = d->phase == ProgressInfo::Scan ? now - d->scanStart : d->scanTime;
+    info.transferTime = d->phase == ProgressInfo::Scan ? 0 : now - d->transferStart;
+    info.throughput = info.transferTime > 0 ? info.bytes * 1000.0 / info.transferTime : 0;
+
+    d->last = info;
+    return ++d->sequence;
+}
+
+void ProgressTracker::notify(const ProgressInfo &info, qint64 sequence) const
+{
+    if (!d->callback) {
+        return;
+    }
+
+    // The callback is not called under d->mutex, so it could call Progress::info().
+    // A snapshot taken before the one already delivered is dropped, so Finished is always the last call
+    QMutexLocker locker(&d->callbackMutex);
+    if (sequence <= d->delivered) {
+        return;
+    }
+    d->delivered = sequence;
+    d->callback(info);
+}
+
+void QtShell::Private::countTree(const QString &path, bool hidden, qint64 &files, qint64 &bytes)
+{
+    QFileInfo info(path);
+
+    if (!info.isDir() || info.isSymLink()) {
+        files++;
+        bytes += info.size();
+        return;
+    }
+
+    QDir::Filters filters = QDir::AllEntries | QDir::NoDotAndDotDot;
+    if (hidden) {
+        filters |= QDir::Hidden | QDir::System;
+    }
+
+    QFileInfoList infos = QDir(path).entryInfoList(filters);
+    for (int i = 0 ; i < infos.size() ; i++) {
+        const QFileInfo& child = infos.at(i);
+        if (child.isDir() && !child.isSymLink()) {
+            countTree(child.filePath(), hidden, files, bytes);
+        } else {
+            files++;
+            bytes += child.size();
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef QTSHELLPROGRESS_H
+#define QTSHELLPROGRESS_H
+
+#include <QMutex>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include "qtshell.h"
+
+class QtShell::Progress::Data {
+public:
+    Callback callback;
+    int interval;
+    bool scan;
+
+    QElapsedTimer timer;
+
+    QAtomicInteger<qint64> files;
+    QAtomicInteger<qint64> bytes;
+    QAtomicInteger<qint64> nextReport;
+
+    // Guard the fields below
+    QMutex mutex;
+    ProgressInfo::Phase phase;
+    qint64 totalFiles;
+    qint64 totalBytes;
+    qint64 scanStart;
+    qint64 scanTime;
+    qint64 transferStart;
+    ProgressInfo last;
+    // No. of snapshots taken
+    qint64 sequence;
+
+    // Serialize the calls of callback. It is not held with mutex
+    QMutex callbackMutex;
+    // The sequence of the last snapshot passed to callback
+    qint64 delivered;
+};
+
+namespace QtShell {
+
+    namespace Private {
+
+        /// The updating side of a Progress. It does nothing if no Progress is given, so callers could use it unconditionally.
+        /// add() is thread-safe.
+        class ProgressTracker {
+        public:
+            explicit ProgressTracker(Progress* progress = 0);
+
+            bool isEnabled() const {
+                return d != 0;
+            }
+
+            bool scan() const {
+                return d != 0 && d->scan;
+            }
+
+            /// Reset the counters and enter the scan phase
+            void startScan();
+
+            void setTotal(qint64 files, qint64 bytes);
+
+            /// Enter the transfer phase. It resets the counters if startScan() is not called
+            void startTransfer();
+
+            void add(qint64 files, qint64 bytes) const {
+                if (d) {
+                    d->files.fetchAndAddRelaxed(files);
+                    d->bytes.fetchAndAddRelaxed(bytes);
+                    reportIfDue();
+                }
+            }
+
+            void finish();
+
+        private:
+            void reset();
+
+            void reportIfDue() const;
+
+            /// Take the current info. d->mutex must be locked. It returns the sequence no. of the snapshot
+            qint64 snapshot(ProgressInfo& info) const;
+
+            /// Pass a snapshot to the callback. d->mutex must not be locked
+            void notify(const ProgressInfo& info, qint64 sequence) const;
+
+            Progress::Data* d;
+        };
+
+        /// Count the files (anything but directories) and bytes of a path recursively, for the scan phase of rm.
+        /// Symbolic links to directories are counted as files and not followed. Hidden files are skipped unless "hidden" is true.
+        void countTree(const QString& path, bool hidden, qint64& files, qint64& bytes);
+    }
+}
+
+#endif // QTSHELLPROGRESS_H
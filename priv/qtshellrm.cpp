@@ -0,0 +1,862 @@
+#include <QtCore>
+#include <QCommandLineParser>
+#include "qtshell.h"
+#include "priv/qtshellpriv.h"
+#include "priv/qtshellpool.h"
+#include "priv/qtshellprogress.h"
+
+#include <QStorageInfo>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <dirent.h>
+#include <fcntl.h>
+#endif
+
+using namespace QtShell::Private;
+
+static QList<QFileInfo> filterLocalFiles(const QList<QFileInfo>& files) {
+    QList<QFileInfo> result;
+    for (int i = 0 ; i < files.size() ; i++) {
+        QFileInfo file = files[i];
+        if (file.fileName() == "." || file.fileName() == "..") {
+            continue;
+        }
+        result << file;
+    }
+
+    return result;
+}
+
+namespace {
+
+    /// The paths protected from rm. The default set comes from QStandardPaths and it is only queried on the first use
+    /// or on refreshPreservedPaths(). A path is stored in its clean absolute form and also in its canonical form if it is a link.
+    class PreservedPaths {
+    public:
+        PreservedPaths() : loaded(false) {
+        }
+
+        QMutex mutex;
+        bool loaded;
+        // Changes made by addPreservedPath() and removePreservedPath(). They are applied again on refresh
+        QSet<QString> added;
+        QSet<QString> removed;
+        QSet<QString> paths;
+
+        void load() {
+            QStringList list;
+            list << "/";
+
+            for (int i = QStandardPaths::DesktopLocation ;
+                 i <= QStandardPaths::AppConfigLocation; i++) {
+                list.append(QStandardPaths::standardLocations((QStandardPaths::StandardLocation) i));
+            }
+
+            paths.clear();
+            foreach (QString path, list) {
+                insert(path);
+            }
+
+            foreach (QString path, added) {
+                insert(path);
+            }
+
+            foreach (QString path, removed) {
+                erase(path);
+            }
+
+            loaded = true;
+        }
+
+        void insert(const QString& path) {
+            QFileInfo info(path);
+            paths.insert(QDir::cleanPath(info.absoluteFilePath()));
+            QString canonical = info.canonicalFilePath();
+            if (!canonical.isEmpty()) {
+                paths.insert(canonical);
+            }
+        }
+
+        void erase(const QString& path) {
+            QFileInfo info(path);
+            paths.remove(QDir::cleanPath(info.absoluteFilePath()));
+            QString canonical = info.canonicalFilePath();
+            if (!canonical.isEmpty()) {
+                paths.remove(canonical);
+            }
+        }
+    };
+
+}
+
+Q_GLOBAL_STATIC(PreservedPaths, preservedPathsData)
+
+// A snapshot of the preserved paths. It is implicitly shared, so it is cheap unless the set is changed meanwhile
+static QSet<QString> preservedSet() {
+    QMutexLocker locker(&preservedPathsData()->mutex);
+    if (!preservedPathsData()->loaded) {
+        preservedPathsData()->load();
+    }
+    return preservedPathsData()->paths;
+}
+
+namespace {
+
+    /// Remove a directory tree bottom-up. Each directory is read by readdir() and its entries are removed by unlinkat()
+    /// relative to the directory fd, with the type taken from d_type. Sub-directories are removed in parallel on a pool,
+    /// and a directory is removed by the worker which finishes its last child. A preserved directory found in the tree is kept.
+    /// A queued sub-directory holds no fd: it is opened by the worker which processes it, relative to the fd of its parent.
+    /// The parent keeps the fd until its last child is done, unless MAX_OPEN_DIRS are kept already, then the children open by path.
+    class TreeRemover {
+    public:
+        TreeRemover(int threads, const ProgressTracker& tracker, const QSet<QString>& preserved, const QAtomicInt* canceled = 0) :
+            pool(0), tracker(tracker), preserved(preserved), canceled(canceled), failed(0), openDirs(0) {
+            if (threads > 1) {
+                pool = new WorkStealingPool(threads);
+            }
+        }
+
+        ~TreeRemover() {
+            delete pool;
+        }
+
+        bool remove(const QString& path);
+
+    private:
+        class Node {
+        public:
+            Node* parent;
+            QString path;
+#ifdef Q_OS_LINUX
+            // The name in the parent directory
+            QByteArray name;
+            // Kept open for the children until the node is released. 0 if the children open by path
+            DIR* dir;
+#endif
+            // The listing of the node itself plus its sub-directories not yet removed
+            QAtomicInt pending;
+        };
+
+        void schedule(Node* node);
+
+        void process(Node* node);
+
+        void release(Node* node);
+
+        WorkStealingPool* pool;
+        const ProgressTracker& tracker;
+        const QSet<QString>& preserved;
+        // Stop the walk when it is set. The entries not visited are kept
+        const QAtomicInt* canceled;
+        QAtomicInt failed;
+        // The no. of Node::dir kept open
+        QAtomicInt openDirs;
+    };
+
+}
+
+bool TreeRemover::remove(const QString &path)
+{
+    Node* root = new Node();
+    root->parent = 0;
+    root->path = path;
+#ifdef Q_OS_LINUX
+    root->dir = 0;
+#endif
+    root->pending.store(1);
+
+    schedule(root);
+
+    if (pool) {
+        pool->waitForDone();
+    }
+
+    return failed.load() == 0;
+}
+
+void TreeRemover::schedule(Node *node)
+{
+    if (pool) {
+        pool->submit([=]() {
+            process(node);
+        });
+    } else {
+        process(node);
+    }
+}
+
+#ifdef Q_OS_LINUX
+
+// The directory fds kept open for the children by a TreeRemover. RLIMIT_NOFILE is shared with the rest of the process
+static const int MAX_OPEN_DIRS = 128;
+
+void TreeRemover::process(Node *node)
+{
+    const int flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+    Node* parent = node->parent;
+
+    // The parent is not released before this node, so its dir is still open
+    int fd = parent && parent->dir ? openat(dirfd(parent->dir), node->name.constData(), flags)
+                                   : ::open(QFile::encodeName(node->path).constData(), flags);
+    DIR* dir = fd >= 0 ? fdopendir(fd) : 0;
+
+    if (!dir) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        failed.ref();
+        release(node);
+        return;
+    }
+
+    // Decided before any child is scheduled, as the children read node->dir
+    if (openDirs.fetchAndAddOrdered(1) < MAX_OPEN_DIRS) {
+        node->dir = dir;
+    } else {
+        openDirs.deref();
+    }
+
+    struct dirent* ent;
+    struct stat st;
+
+    while ((ent = readdir(dir)) != 0) {
+        const char* name = ent->d_name;
+
+        if (canceled && canceled->load()) {
+            failed.ref();
+            break;
+        }
+
+        if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) {
+            continue;
+        }
+
+        bool isDir = ent->d_type == DT_DIR;
+
+        if (ent->d_type == DT_UNKNOWN) {
+            if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                failed.ref();
+                continue;
+            }
+            isDir = S_ISDIR(st.st_mode);
+        }
+
+        if (isDir) {
+            QString path = node->path + "/" + QFile::decodeName(name);
+
+            if (preserved.contains(path)) {
+                qWarning() << QString("rm: %1: is a preserved directory").arg(path);
+                failed.ref();
+                continue;
+            }
+
+            Node* child = new Node();
+            child->parent = node;
+            child->path = path;
+            child->name = name;
+            child->dir = 0;
+            child->pending.store(1);
+            node->pending.ref();
+            schedule(child);
+            continue;
+        }
+
+        qint64 size = 0;
+        if (tracker.isEnabled() && fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+            size = st.st_size;
+        }
+
+        if (unlinkat(fd, name, 0) == 0) {
+            tracker.add(1, size);
+        } else {
+            failed.ref();
+        }
+    }
+
+    if (!node->dir) {
+        closedir(dir);
+    }
+
+    release(node);
+}
+
+#else
+
+void TreeRemover::process(Node *node)
+{
+    QFileInfoList infos = QDir(node->path).entryInfoList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+
+    foreach (QFileInfo info, infos) {
+        if (canceled && canceled->load()) {
+            failed.ref();
+            break;
+        }
+
+        if (info.isDir() && !info.isSymLink()) {
+            QString path = info.absoluteFilePath();
+
+            if (preserved.contains(path)) {
+                qWarning() << QString("rm: %1: is a preserved directory").arg(path);
+                failed.ref();
+                continue;
+            }
+
+            Node* child = new Node();
+            child->parent = node;
+            child->path = path;
+            child->pending.store(1);
+            node->pending.ref();
+            schedule(child);
+            continue;
+        }
+
+        bool removed = QFile::remove(info.filePath());
+        if (!removed) {
+            // Could be a read-only file
+            QFile::setPermissions(info.filePath(), info.permissions() | QFile::WriteUser);
+            removed = QFile::remove(info.filePath());
+        }
+
+        if (removed) {
+            tracker.add(1, tracker.isEnabled() ? info.size() : 0);
+        } else {
+            failed.ref();
+        }
+    }
+
+    release(node);
+}
+
+#endif
+
+void TreeRemover::release(Node *node)
+{
+    // Remove the directories which have nothing left, from the bottom up
+    while (node && !node->pending.deref()) {
+        Node* parent = node->parent;
+        bool removed;
+
+#ifdef Q_OS_LINUX
+        if (node->dir) {
+            closedir(node->dir);
+            openDirs.deref();
+        }
+
+        removed = parent && parent->dir ? unlinkat(dirfd(parent->dir), node->name.constData(), AT_REMOVEDIR) == 0
+                                        : QDir().rmdir(node->path);
+#else
+        removed = QDir().rmdir(node->path);
+#endif
+
+        if (!removed) {
+            failed.ref();
+        }
+
+        delete node;
+        node = parent;
+    }
+}
+
+// The name of the hidden directory holding the entries removed by rm --defer
+static const char* TRASH_NAME = ".qtshell-trash";
+
+namespace {
+
+    /// Empty the trash directories on a low priority thread. The thread is started on demand and quits when there is nothing left.
+    class TrashReaper : public QThread {
+    public:
+        TrashReaper() : running(false), started(false), stopped(0) {
+        }
+
+        ~TrashReaper() {
+            // The tree remover checks it between entries, so a large tree does not block the exit
+            stopped.store(1);
+            // The rest is reclaimed by the first rm --defer of the next run
+            wait();
+        }
+
+        void reclaim(const QString& trash) {
+            QMutexLocker locker(&mutex);
+            if (!queue.contains(trash)) {
+                queue << trash;
+            }
+
+            if (!running) {
+                running = true;
+                // The previous run may be returning
+                wait();
+                start(QThread::LowestPriority);
+            }
+        }
+
+        bool waitForDone(int msecs) {
+            QElapsedTimer timer;
+            timer.start();
+
+            QMutexLocker locker(&mutex);
+            while (running) {
+                if (msecs < 0) {
+                    done.wait(&mutex);
+                } else {
+                    qint64 remaining = msecs - timer.elapsed();
+                    if (remaining <= 0 || !done.wait(&mutex, remaining)) {
+                        return !running;
+                    }
+                }
+            }
+            return true;
+        }
+
+    protected:
+        void run() override;
+
+    private:
+        QMutex mutex;
+        QWaitCondition done;
+        QStringList queue;
+        bool running;
+        // The first run also empties the trashes left by the previous runs. Only accessed by the thread
+        bool started;
+        QAtomicInt stopped;
+    };
+
+}
+
+Q_GLOBAL_STATIC(TrashReaper, trashReaper)
+
+// The top directory of the file system holding the path
+static QString mountRoot(const QString& path) {
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if (::lstat(QFile::encodeName(path).constData(), &st) != 0) {
+        return QString();
+    }
+
+    QString root = path;
+    while (root != "/") {
+        QString parent = QtShell::dirname(root);
+        struct stat parentStat;
+        if (::stat(QFile::encodeName(parent).constData(), &parentStat) != 0 || parentStat.st_dev != st.st_dev) {
+            break;
+        }
+        root = parent;
+    }
+
+    return root;
+#else
+    QStorageInfo storage(path);
+    return storage.isValid() ? storage.rootPath() : QString();
+#endif
+}
+
+static QString joinTrash(const QString& dir) {
+    return dir.endsWith(QChar('/')) ? dir + TRASH_NAME : dir + "/" + TRASH_NAME;
+}
+
+// A trash is only used if it is a real directory (not a link) owned by the user and closed to others.
+// On a shared file system (e.g. /tmp), another user could create it first to receive the removed trees.
+static bool isOwnTrash(const QString& trash) {
+#ifdef Q_OS_UNIX
+    struct stat st;
+    return ::lstat(QFile::encodeName(trash).constData(), &st) == 0 && S_ISDIR(st.st_mode) &&
+           st.st_uid == ::geteuid() && (st.st_mode & 07777) == 0700;
+#else
+    QFileInfo info(trash);
+    return info.isDir() && !info.isSymLink();
+#endif
+}
+
+// Create the trash if it does not exist. It returns false if the trash could not be used
+static bool makeTrash(const QString& trash) {
+#ifdef Q_OS_UNIX
+    // Created with its final mode, so it is never open to others. An existing one is checked by isOwnTrash()
+    QByteArray path = QFile::encodeName(trash);
+    if (::mkdir(path.constData(), 0700) == 0) {
+        // The umask may have taken some of the owner bits
+        ::chmod(path.constData(), 0700);
+    }
+#else
+    QDir().mkdir(trash);
+#endif
+    return isOwnTrash(trash);
+}
+
+// The trash in the cache directory of the user. It takes the entries on a file system whose top is not writable, e.g. the home
+static QString userTrash() {
+    QString cache = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    return cache.isEmpty() ? QString() : joinTrash(cache);
+}
+
+static bool sameFileSystem(const QString& path1, const QString& path2) {
+#ifdef Q_OS_UNIX
+    struct stat st1;
+    struct stat st2;
+    return ::stat(QFile::encodeName(path1).constData(), &st1) == 0 && ::stat(QFile::encodeName(path2).constData(), &st2) == 0 &&
+           st1.st_dev == st2.st_dev;
+#else
+    QStorageInfo storage1(path1);
+    QStorageInfo storage2(path2);
+    return storage1.isValid() && storage2.isValid() && storage1.rootPath() == storage2.rootPath();
+#endif
+}
+
+// The trash directories for the entries of a directory, in the order to try: the top of its file system, then the trash of the user
+// if it is on the same file system. No trash is made anywhere else, so knownTrashes() finds all of them
+static QStringList trashCandidates(const QString& dir) {
+    QStringList candidates;
+
+    QString root = mountRoot(dir);
+    if (!root.isEmpty()) {
+        candidates << joinTrash(root);
+    }
+
+    QString user = userTrash();
+    if (!user.isEmpty() && !candidates.contains(user) && sameFileSystem(QtShell::dirname(user), dir)) {
+        candidates << user;
+    }
+
+    return candidates;
+}
+
+// The trashes of this user on all the mounted file systems
+static QStringList knownTrashes() {
+    QStringList trashes;
+
+    foreach (QStorageInfo storage, QStorageInfo::mountedVolumes()) {
+        if (!storage.isValid() || !storage.isReady() || storage.isReadOnly()) {
+            continue;
+        }
+
+        QString trash = joinTrash(storage.rootPath());
+        if (isOwnTrash(trash)) {
+            trashes << trash;
+        }
+    }
+
+    QString user = userTrash();
+    if (!user.isEmpty() && !trashes.contains(user) && isOwnTrash(user)) {
+        trashes << user;
+    }
+
+    return trashes;
+}
+
+void TrashReaper::run()
+{
+    ProgressTracker tracker;
+    QSet<QString> preserved;
+
+    if (!started) {
+        started = true;
+        QStringList trashes = knownTrashes();
+
+        QMutexLocker locker(&mutex);
+        foreach (QString trash, trashes) {
+            if (!queue.contains(trash)) {
+                queue << trash;
+            }
+        }
+    }
+
+    forever {
+        QString trash;
+        {
+            QMutexLocker locker(&mutex);
+            if (queue.isEmpty() || stopped.load()) {
+                running = false;
+                done.wakeAll();
+                return;
+            }
+            trash = queue.takeFirst();
+        }
+
+        QFileInfoList infos = QDir(trash).entryInfoList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+
+        foreach (QFileInfo info, infos) {
+            if (stopped.load()) {
+                break;
+            }
+
+            // Another process sharing the trash may have removed it already. So the errors are ignored
+            if (info.isDir() && !info.isSymLink()) {
+                TreeRemover remover(1, tracker, preserved, &stopped);
+                remover.remove(info.absoluteFilePath());
+            } else {
+                QFile::remove(info.absoluteFilePath());
+            }
+        }
+    }
+}
+
+// Rename the path into a trash directory on the same file system. It returns the trash directory used, or an empty string if
+// there is no usable trash, then the path should be removed in place.
+static QString moveToTrash(const QString& path) {
+    static QAtomicInt counter;
+
+    QString name = QString("%1.%2.%3").arg(QtShell::basename(path))
+                                      .arg(QCoreApplication::applicationPid())
+                                      .arg(counter.fetchAndAddRelaxed(1));
+
+    foreach (QString trash, trashCandidates(QtShell::dirname(path))) {
+        if (!makeTrash(trash)) {
+            continue;
+        }
+
+        if (QDir().rename(path, trash + "/" + name)) {
+            return trash;
+        }
+    }
+
+    return QString();
+}
+
+// True if any of the preserved paths is inside the directory
+static bool containsPreserved(const QString& dir, const QSet<QString>& preserved) {
+    QString prefix = dir.endsWith(QChar('/')) ? dir : dir + "/";
+
+    foreach (QString path, preserved) {
+        if (path.startsWith(prefix)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+namespace {
+
+    class RmOptions {
+    public:
+        RmOptions() : recursive(false), verbose(false), force(false), defer(false), threads(1) {
+        }
+
+        bool recursive;
+        bool verbose;
+        bool force;
+        // Move into the trash and remove it on a background thread
+        bool defer;
+        int threads;
+    };
+
+}
+
+static bool _rm(const QString &file, const RmOptions& options, QtShell::Progress* progress = 0)
+{
+    QString path = file;
+
+    if (path.isEmpty()) {
+        qWarning() << "rm: it do not accept empty argument";
+        return false;
+    }
+
+    path = normalize(path);
+
+    bool res = true;
+    QString folder = QtShell::dirname(path);
+    QString filter = QtShell::basename(path);
+
+    QDir dir(folder);
+
+    QList<QFileInfo> files = dir.entryInfoList(QStringList() << filter);
+    files = filterLocalFiles(files);
+
+    if (files.size() == 0) {
+        if (!options.force) {
+            qWarning() << QString("rm: %1: No such file or directory").arg(filter);
+            return false;
+        }
+
+        // If force is true, remove a non existed files is not a problem
+        return true;
+    }
+
+    ProgressTracker tracker(progress);
+
+    if (tracker.scan() && !options.defer) {
+        qint64 total = 0;
+        qint64 bytes = 0;
+        tracker.startScan();
+        foreach (QFileInfo file, files) {
+            countTree(file.absoluteFilePath(), true, total, bytes);
+        }
+        tracker.setTotal(total, bytes);
+    }
+
+    tracker.startTransfer();
+
+    QSet<QString> preserved = preservedSet();
+
+    foreach (QFileInfo file, files) {
+        if (preserved.contains(file.absoluteFilePath())) {
+            qWarning() << QString("rm: %1: is a preserved directory").arg(file.absoluteFilePath());
+            continue;
+        }
+
+        // A symbolic link to a directory is removed as a file. Its target is not touched
+        bool isDir = file.isDir() && !file.isSymLink();
+
+        if (isDir && !options.recursive) {
+            qWarning() << QString("rm: %1: is a directory").arg(file.fileName());
+            res = false;
+            continue;
+        }
+
+        if (options.verbose) { qDebug().noquote() << file.absoluteFilePath();}
+
+        // The trash is emptied as a whole, so a directory holding a preserved path is removed now by the tree remover
+        if (options.defer && file.fileName() != TRASH_NAME && !(isDir && containsPreserved(file.absoluteFilePath(), preserved))) {
+            QString trash = moveToTrash(file.absoluteFilePath());
+            if (!trash.isEmpty()) {
+                trashReaper()->reclaim(trash);
+                tracker.add(1, 0);
+                continue;
+            }
+            // Could not be renamed. Remove it now
+        }
+
+        if (isDir) {
+            TreeRemover remover(options.threads, tracker, preserved);
+            if (!remover.remove(file.absoluteFilePath())) {
+                res = false;
+                qWarning() << QString("rm: %1: can not remove the directory").arg(file.absoluteFilePath());
+            }
+            continue;
+        }
+
+        if (!QFile::remove(file.absoluteFilePath()) ) {
+            qWarning() << QString("rm: %1: can not remove the file").arg(file.fileName());
+            res = false;
+        } else {
+            tracker.add(1, file.size());
+        }
+    }
+
+    tracker.finish();
+
+    return res;
+}
+
+static bool parseRmOptions(const QString &options, RmOptions& rmOptions)
+{
+    QCommandLineParser parser;
+    parser.addOption(QCommandLineOption("v"));
+    parser.addOption(QCommandLineOption("r"));
+    parser.addOption(QCommandLineOption("R"));
+    parser.addOption(QCommandLineOption("f")); // dummy
+    parser.addOption(QCommandLineOption("j", "", "jobs"));
+    parser.addOption(QCommandLineOption("defer"));
+
+    // Options could be passed as "-rf -j 4"
+    if (!parser.parse(QStringList() << "rm" << options.split(QChar(' '), QString::SkipEmptyParts))) {
+        qWarning() << QString("rm: %1").arg(parser.errorText());
+        return false;
+    }
+
+    rmOptions.recursive = parser.isSet("r") || parser.isSet("R");
+    rmOptions.verbose = parser.isSet("v");
+    rmOptions.force = parser.isSet("f");
+    rmOptions.defer = parser.isSet("defer");
+
+    if (parser.isSet("j")) {
+        bool ok = false;
+        rmOptions.threads = WorkStealingPool::resolveThreadCount(parser.value("j").toInt(&ok));
+        if (!ok) {
+            qWarning() << QString("rm: -j: %1: Invalid number").arg(parser.value("j"));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool QtShell::rm(const QString &options, const QString &file)
+{
+    RmOptions rmOptions;
+    if (!parseRmOptions(options, rmOptions)) {
+        return false;
+    }
+
+    return _rm(file, rmOptions);
+}
+
+bool QtShell::rm(const QString &options, const QString &file, Progress &progress)
+{
+    RmOptions rmOptions;
+    if (!parseRmOptions(options, rmOptions)) {
+        return false;
+    }
+
+    return _rm(file, rmOptions, &progress);
+}
+
+bool QtShell::rm(const QString &file)
+{
+    return _rm(file, RmOptions());
+}
+
+void QtShell::reclaimTrash(const QString &path)
+{
+    foreach (QString trash, trashCandidates(QFileInfo(path).absoluteFilePath())) {
+        if (isOwnTrash(trash)) {
+            trashReaper()->reclaim(trash);
+        }
+    }
+}
+
+QString QtShell::trashPath(const QString &path)
+{
+    foreach (QString trash, trashCandidates(QtShell::dirname(QFileInfo(path).absoluteFilePath()))) {
+        if (isOwnTrash(trash)) {
+            return trash;
+        }
+    }
+
+    return QString();
+}
+
+bool QtShell::waitForTrash(int msecs)
+{
+    return trashReaper()->waitForDone(msecs);
+}
+
+QStringList QtShell::preservedPaths()
+{
+    QStringList paths = preservedSet().toList();
+    paths.sort();
+    return paths;
+}
+
+void QtShell::addPreservedPath(const QString &path)
+{
+    QMutexLocker locker(&preservedPathsData()->mutex);
+    if (!preservedPathsData()->loaded) {
+        preservedPathsData()->load();
+    }
+
+    preservedPathsData()->added.insert(path);
+    preservedPathsData()->removed.remove(path);
+    preservedPathsData()->insert(path);
+}
+
+void QtShell::removePreservedPath(const QString &path)
+{
+    QMutexLocker locker(&preservedPathsData()->mutex);
+    if (!preservedPathsData()->loaded) {
+        preservedPathsData()->load();
+    }
+
+    preservedPathsData()->removed.insert(path);
+    preservedPathsData()->added.remove(path);
+    preservedPathsData()->erase(path);
+}
+
+void QtShell::refreshPreservedPaths()
+{
+    QMutexLocker locker(&preservedPathsData()->mutex);
+    preservedPathsData()->load();
+}
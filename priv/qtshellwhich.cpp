@@ -0,0 +1,231 @@
+#include <QtCore>
+#include <QCommandLineParser>
+#include "qtshell.h"
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+    /// The lookups in a directory of PATH. A name is cached as missing or as an existing regular file, which is only dropped
+    /// when the modification time of the directory is changed. chmod does not change the directory, so the permission
+    /// of an existing file is checked again on every lookup.
+    class CachedDir {
+    public:
+        CachedDir() : lastModified(-1), generation(-1) {
+        }
+
+        // -1 if the directory does not exist
+        qint64 lastModified;
+
+        // The WhichCache::generation of the last check of the modification time
+        int generation;
+
+        // Program name to whether a regular file of that name exists in the directory
+        QHash<QString, bool> programs;
+    };
+
+    /// A cache of which() keyed on the value of PATH. It is thread-safe.
+    class WhichCache {
+    public:
+        WhichCache() : generation(0) {
+        }
+
+        QMutex mutex;
+        QByteArray path;
+        QStringList dirs;
+        // The dirs resolved against the current directory by the last validate()
+        QStringList absoluteDirs;
+        QHash<QString, CachedDir> cachedDirs;
+        // Increased by every validate(). A directory is only stat'ed when a lookup reaches it, once per generation
+        int generation;
+
+        /// Reload the directories if PATH is changed and start a new generation
+        void validate();
+
+        bool isExecutable(const QString& dir, const QString& program);
+    };
+
+}
+
+Q_GLOBAL_STATIC(WhichCache, whichCache)
+
+static qint64 lastModified(const QString& dir) {
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if (::stat(QFile::encodeName(dir).constData(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return -1;
+    }
+    // Nanoseconds, so a change within the same second is not missed
+#ifdef Q_OS_DARWIN
+    return (qint64) st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    return (qint64) st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+#else
+    QFileInfo info(dir);
+    return info.isDir() ? info.lastModified().toMSecsSinceEpoch() : -1;
+#endif
+}
+
+static bool isExecutableFile(const QString& file, bool* exists) {
+#ifdef Q_OS_UNIX
+    QByteArray encoded = QFile::encodeName(file);
+    struct stat st;
+    *exists = ::stat(encoded.constData(), &st) == 0 && S_ISREG(st.st_mode);
+    return *exists && ::access(encoded.constData(), X_OK) == 0;
+#else
+    QFileInfo info(file);
+    *exists = info.isFile();
+    return *exists && info.isExecutable();
+#endif
+}
+
+void WhichCache::validate()
+{
+    QByteArray value = qgetenv("PATH");
+
+    if (value != path || dirs.isEmpty()) {
+#ifdef Q_OS_WIN32
+        QChar separator = ';';
+#else
+        QChar separator = ':';
+#endif
+        path = value;
+        dirs.clear();
+        cachedDirs.clear();
+
+        foreach (QString dir, QFile::decodeName(value).split(separator)) {
+            // An empty entry is the current directory
+            dirs << (dir.isEmpty() ? QString(".") : dir);
+        }
+    }
+
+    QDir current = QDir::current();
+    absoluteDirs.clear();
+
+    for (int i = 0 ; i < dirs.size() ; i++) {
+        // A relative entry depends on the current directory, so it is cached by the absolute path
+        absoluteDirs << QDir::cleanPath(current.absoluteFilePath(dirs[i]));
+    }
+
+    generation++;
+}
+
+bool WhichCache::isExecutable(const QString &dir, const QString &program)
+{
+    CachedDir& cached = cachedDirs[dir];
+
+    if (cached.generation != generation) {
+        qint64 modified = lastModified(dir);
+        if (cached.lastModified != modified) {
+            cached.lastModified = modified;
+            cached.programs.clear();
+        }
+        cached.generation = generation;
+    }
+
+    if (cached.lastModified < 0) {
+        return false;
+    }
+
+    QString file = dir + "/" + program;
+    QHash<QString, bool>::const_iterator iter = cached.programs.constFind(program);
+
+    if (iter != cached.programs.constEnd()) {
+        if (!iter.value()) {
+            return false;
+        }
+
+#ifdef Q_OS_UNIX
+        // The permission may be changed without touching the directory
+        return ::access(QFile::encodeName(file).constData(), X_OK) == 0;
+#else
+        return QFileInfo(file).isExecutable();
+#endif
+    }
+
+    bool exists;
+    bool res = isExecutableFile(file, &exists);
+    cached.programs[program] = exists;
+    return res;
+}
+
+// Find the program in the directories of PATH. If all is false, it stops at the first match
+static QStringList lookup(WhichCache* cache, const QString& program, bool all) {
+    QStringList res;
+
+    if (program.isEmpty()) {
+        return res;
+    }
+
+#ifdef Q_OS_WIN32
+    QString exec = program + ".exe";
+#else
+    QString exec = program;
+#endif
+
+    for (int i = 0 ; i < cache->absoluteDirs.size() ; i++) {
+        const QString& dir = cache->absoluteDirs.at(i);
+
+        if (cache->isExecutable(dir, exec)) {
+            QString file = QDir::toNativeSeparators(QDir::cleanPath(dir + "/" + exec));
+            if (!res.contains(file)) {
+                res << file;
+            }
+            if (!all) {
+                break;
+            }
+        }
+    }
+
+    return res;
+}
+
+QString QtShell::which(const QString &program)
+{
+    WhichCache* cache = whichCache();
+    QMutexLocker locker(&cache->mutex);
+    cache->validate();
+
+    QStringList res = lookup(cache, program, false);
+    return res.isEmpty() ? QString() : res.first();
+}
+
+QStringList QtShell::which(const QString &options, const QString &program)
+{
+    QCommandLineParser parser;
+    parser.addOption(QCommandLineOption("a"));
+
+    if (!parser.parse(QStringList() << "which" << options.split(QChar(' '), QString::SkipEmptyParts))) {
+        qWarning() << QString("which: %1").arg(parser.errorText());
+        return QStringList();
+    }
+
+    WhichCache* cache = whichCache();
+    QMutexLocker locker(&cache->mutex);
+    cache->validate();
+
+    return lookup(cache, program, parser.isSet("a"));
+}
+
+QStringList QtShell::which(const QStringList &programs)
+{
+    WhichCache* cache = whichCache();
+    QMutexLocker locker(&cache->mutex);
+
+    // The directories are checked once for the whole batch
+    cache->validate();
+
+    QStringList res;
+    res.reserve(programs.size());
+
+    for (int i = 0 ; i < programs.size() ; i++) {
+        QStringList found = lookup(cache, programs[i], false);
+        res << (found.isEmpty() ? QString() : found.first());
+    }
+
+    return res;
+}
@@ -3,22 +3,374 @@
 
 #include <QStringList>
 #include <QPair>
+#include <QSharedPointer>
+#include <QFileInfo>
+#include <QVector>
+#include <QDateTime>
+#include <QFuture>
+#include <QHash>
+#include <functional>
+
+class QThreadPool;
+class QIODevice;
 
 namespace QtShell {
 
+    namespace Private {
+        class FindWalker;
+        class ProgressTracker;
+    }
+
     QString dirname(const QString& path);
 
     QString basename(const QString& path);
 
+    /// A set of wildcard patterns (*, ? and [...]) compiled once and matched against file names.
+    /// It is the same syntax as QRegExp::Wildcard. A name is matched if any of the patterns is matched.
+    /// A matcher without any pattern matches everything. It is cheap to copy and thread-safe to share.
+    class GlobMatcher {
+    public:
+        GlobMatcher();
+
+        explicit GlobMatcher(const QString& pattern, Qt::CaseSensitivity cs = Qt::CaseInsensitive);
+
+        explicit GlobMatcher(const QStringList& patterns, Qt::CaseSensitivity cs = Qt::CaseInsensitive);
+
+        bool isEmpty() const;
+
+        QStringList patterns() const;
+
+        bool match(const QString& fileName) const;
+
+    private:
+        class Data;
+        QSharedPointer<const Data> d;
+    };
+
     class FindOptions {
     public:
         FindOptions();
 
+        // Descend at most maxdepth levels of directories. -1 (default) means no limit
         int maxdepth;
+
+        // Do not report entries at levels less than mindepth. -1 (default) means no limit
+        int mindepth;
+
+        // Only report the entries of the types. "f" for regular files, "d" for directories and "l" for symbolic links. e.g "fl". Empty (default) for any type
+        QString type;
+
+        // Only report the entries of size within [minsize, maxsize] in bytes. -1 (default) means no limit
+        qint64 minsize;
+
+        qint64 maxsize;
+
+        // Only report the entries modified after "newer" and before "older". An invalid QDateTime (default) means no limit
+        QDateTime newer;
+
+        QDateTime older;
+
+        // Name patterns of directories to be skipped. A matched directory is neither reported nor descended
+        QStringList prune;
+
+        // Stop the walk after "limit" entries are reported. -1 (default) means no limit
+        int limit;
+
+        // No. of threads to walk the sub-directories. 1 (default) walks on the calling thread. 0 uses QThread::idealThreadCount()
+        int threads;
+
+        // Keep the same order of result as a single thread walk when threads != 1. The entries are reported as soon as their directory is
+        // reached in that order. Only 16 directories per thread are scanned ahead, so a narrow tree gains less from the threads.
+        bool ordered;
+
+        // Sort the entries of a directory by name (default). Set it to false to take the order from the file system
+        bool sorted;
+    };
+
+    /// An entry visited by find()
+    class FindEntry {
+    public:
+        enum Type {
+            Unknown,
+            File,
+            Dir,
+            SymLink,
+            Other
+        };
+
+        FindEntry();
+
+        // The path in the same form as the path passed to find()
+        QString path;
+
+        QString absoluteFilePath;
+
+        QString fileName;
+
+        // 0 for the starting point of the walk
+        int depth;
+
+        // Type of the entry itself. A symbolic link is reported as SymLink even it points to a directory
+        Type type;
+
+        // The stat data of the entry. It is only fetched on the first call if the walker has not fetched it already
+        QFileInfo info() const;
+
+    private:
+        friend class Private::FindWalker;
+
+        mutable QFileInfo m_info;
+    };
+
+    enum FindAction {
+        FindContinue,
+        FindPrune, // Do not descend into the directory
+        FindStop   // Stop the walk
+    };
+
+    typedef std::function<FindAction(const FindEntry& entry)> FindVisitor;
+
+    /// A compact container of the paths found by find(). Each entry only keeps its own name and the index of its parent directory,
+    /// so the common prefix is shared. The full path is built on request.
+    class FindResult {
+    public:
+        FindResult();
+
+        int size() const;
+
+        bool isEmpty() const;
+
+        /// The full path of the entry in the same form as the result of find()
+        QString at(int index) const;
+
+        QString fileName(int index) const;
+
+        QStringList toStringList() const;
+
+        void clear();
+
+    private:
+        friend class Private::FindWalker;
+
+        class Node {
+        public:
+            int parent;
+            int offset;
+            int length;
+        };
+
+        int append(int parent, const QString& name, bool matched);
+
+        QString path(int node) const;
+
+        QString m_root;
+
+        // Add a "/" between the root and the entries inside. It is false if the root is "/"
+        bool m_rootSeparator;
+
+        // Names of all the nodes in UTF-16
+        QString m_names;
+
+        QVector<Node> m_nodes;
+
+        // Indexes of the nodes matched
+        QVector<int> m_items;
     };
 
     QStringList find(const FindOptions& options, const QString& path, const QStringList& nameFilters = QStringList());
 
+    QStringList find(const FindOptions& options, const QString& path, const GlobMatcher& matcher);
+
+    /// Walk a file hierarchy and pass each matched entry to the visitor as soon as it is found.
+    /// When threads != 1, the visitor is called from the worker threads one at a time.
+    /// It returns false if the walk is stopped by the visitor.
+    bool find(const FindOptions& options, const QString& path, const QStringList& nameFilters, const FindVisitor& visitor);
+
+    bool find(const FindOptions& options, const QString& path, const GlobMatcher& matcher, const FindVisitor& visitor);
+
+    /// Walk a file hierarchy and store the result in a FindResult. It takes much less memory than QStringList for a large result.
+    bool find(const FindOptions& options, const QString& path, const QStringList& nameFilters, FindResult& result);
+
+    bool find(const FindOptions& options, const QString& path, const GlobMatcher& matcher, FindResult& result);
+
+    /// A cached directory tree for repeated find() calls on the same root. The first query walks the disk and
+    /// the following queries are answered from memory. The cache is kept fresh by inotify on Linux. On other
+    /// platforms (or if the inotify watch limit is reached), a cached directory is validated by its modification time.
+    /// It is thread-safe, but the visitor must not call the same index.
+    class FindIndex {
+    public:
+        explicit FindIndex(const QString& root);
+
+        ~FindIndex();
+
+        QString root() const;
+
+        QStringList find(const FindOptions& options, const QStringList& nameFilters = QStringList());
+
+        QStringList find(const QStringList& nameFilters = QStringList());
+
+        bool find(const FindOptions& options, const QStringList& nameFilters, const FindVisitor& visitor);
+
+        /// Drop all the cached directories
+        void clear();
+
+    private:
+        Q_DISABLE_COPY(FindIndex)
+
+        class Data;
+        Data* d;
+    };
+
+    /// Run find() on a QThreadPool (QThreadPool::globalInstance() by default) and report the paths in batches as they are found.
+    /// The walk stops as soon as the future is canceled.
+    QFuture<QString> findAsync(const FindOptions& options, const QString& path, const QStringList& nameFilters = QStringList(), QThreadPool* pool = 0);
+
+    /// A snapshot of the progress of cp, mv or rm
+    class ProgressInfo {
+    public:
+        enum Phase {
+            Scan,     // Counting the totals before the transfer. Only if Progress::scan() is true
+            Transfer,
+            Finished
+        };
+
+        ProgressInfo();
+
+        Phase phase;
+
+        // No. of files and bytes done
+        qint64 files;
+
+        qint64 bytes;
+
+        // The totals found by the scan phase. -1 if the scan is not enabled
+        qint64 totalFiles;
+
+        qint64 totalBytes;
+
+        // Time in ms since the start, spent in the scan phase and spent in the transfer phase
+        qint64 elapsed;
+
+        qint64 scanTime;
+
+        qint64 transferTime;
+
+        // Bytes per second in the transfer phase
+        double throughput;
+    };
+
+    /// Receive the progress of a cp, mv or rm call. The callback is called at most once per interval (ms),
+    /// and once more when the call is finished. It may be called from a worker thread, but never concurrently.
+    /// The callback may call info(). The Finished snapshot is always the last call.
+    /// A Progress object should only be used by one call at a time.
+    class Progress {
+    public:
+        typedef std::function<void(const ProgressInfo& info)> Callback;
+
+        explicit Progress(const Callback& callback, int interval = 500, bool scan = false);
+
+        ~Progress();
+
+        int interval() const;
+
+        /// Count the totals before the transfer starts
+        bool scan() const;
+
+        /// The latest snapshot
+        ProgressInfo info() const;
+
+    private:
+        Q_DISABLE_COPY(Progress)
+        friend class Private::ProgressTracker;
+
+        class Data;
+        Data* d;
+    };
+
+    /// A sink of the (source, target) pairs recorded by cp and mv
+    class Journal {
+    public:
+        virtual ~Journal();
+
+        virtual void append(const QString& source, const QString& target) = 0;
+    };
+
+    /// An in-memory journal. Each distinct directory string is stored once and the file names are packed into a single buffer,
+    /// so an entry of a large copy costs a few integers plus its file name. Directories do not share their common prefixes.
+    class MemoryJournal : public Journal {
+    public:
+        MemoryJournal();
+
+        void append(const QString& source, const QString& target) override;
+
+        int size() const;
+
+        bool isEmpty() const;
+
+        QPair<QString,QString> at(int index) const;
+
+        QList<QPair<QString,QString> > toList() const;
+
+        void clear();
+
+    private:
+        class Entry {
+        public:
+            int sourceDir;
+            int targetDir;
+            int offset;
+            int sourceLength;
+            // -1 if the target has the same file name as the source
+            int targetLength;
+        };
+
+        int intern(const QString& dir);
+
+        QString join(int dir, int offset, int length) const;
+
+        QStringList m_dirs;
+        QHash<QString, int> m_dirIndex;
+        QString m_names;
+        QVector<Entry> m_entries;
+    };
+
+    /// An append-only journal file. One record per line in UTF-8: the source and the target separated by a tab, with
+    /// "\\", "\t" and "\n" escaped. Records are buffered and written on flush(), close() or when the buffer is full.
+    class FileJournal : public Journal {
+    public:
+        explicit FileJournal(const QString& fileName);
+
+        ~FileJournal();
+
+        QString fileName() const;
+
+        /// Open the file for appending. It is created if it does not exist
+        bool open();
+
+        bool isOpen() const;
+
+        void append(const QString& source, const QString& target) override;
+
+        bool flush();
+
+        void close();
+
+        /// True if any record could not be written, i.e. the journal file is incomplete. It is not reset by close()
+        bool hasError() const;
+
+        typedef std::function<void(const QString& source, const QString& target)> Replayer;
+
+        /// Read back the records of a journal file in order. A truncated last record (e.g. after a crash) is ignored.
+        /// It returns false if the file could not be read.
+        static bool replay(const QString& fileName, const Replayer& replayer);
+
+    private:
+        Q_DISABLE_COPY(FileJournal)
+
+        class Data;
+        Data* d;
+    };
+
     QStringList find(const QString& path, const QStringList& nameFilters = QStringList());
 
     QStringList find(const QString& path, const QString& nameFilter);
@@ -31,6 +383,29 @@ namespace QtShell {
 
     bool rm(const QString& options,const QString& file);
 
+    bool rm(const QString& options,const QString& file, Progress& progress);
+
+    /// The paths never removed by rm: "/", all the QStandardPaths locations and the paths added by addPreservedPath().
+    /// The standard locations are looked up once. Call refreshPreservedPaths() if they are changed (e.g. by QStandardPaths::setTestModeEnabled()).
+    QStringList preservedPaths();
+
+    void addPreservedPath(const QString& path);
+
+    /// Allow rm to remove a path that is preserved by default
+    void removePreservedPath(const QString& path);
+
+    void refreshPreservedPaths();
+
+    /// Queue the leftovers of "rm --defer" on the file system of the path for removal on the background thread.
+    /// The first "rm --defer" of a process does it for all the file systems, so it is not needed at startup.
+    void reclaimTrash(const QString& path);
+
+    /// The existing trash directory that "rm --defer" uses for the path. An empty string if there is none yet
+    QString trashPath(const QString& path);
+
+    /// Wait until the background removal of "rm --defer" is finished. -1 waits forever. It returns false on timeout.
+    bool waitForTrash(int msecs = -1);
+
     bool mkdir(const QString &path);
 
     bool mkdir(const QString &options, const QString &path);
@@ -43,16 +418,69 @@ namespace QtShell {
 
     bool cp(const QString& options, const QString& source , const QString &target, QList<QPair<QString,QString> > &log);
 
+    bool cp(const QString& options, const QString& source , const QString &target, Progress& progress);
+
+    bool cp(const QString& options, const QString& source , const QString &target, Journal& journal);
+
+    /// Extract a qrc directory (e.g ":/assets") into the target directory with no. of threads (0 = ideal thread count).
+    /// A manifest of the resource set is saved in the target, so a later call returns at once if nothing is changed.
+    bool extract(const QString& source, const QString& target, int threads = 0);
+
     bool mv(const QString& source , const QString &target);
 
     bool mv(const QString& source , const QString &target, QList<QPair<QString,QString> > &log);
 
+    bool mv(const QString& source , const QString &target, Progress& progress);
+
+    bool mv(const QString& source , const QString &target, Journal& journal);
+
     QString pwd();
 
     QString cat(const QString& file);
 
     QString cat(const QStringList& files);
 
+    /// Receive a chunk of a file. The chunk is only valid during the call, copy it to keep. Return false to stop reading.
+    typedef std::function<bool(const QByteArray& chunk)> CatCallback;
+
+    /// Read a file in chunks of at most bufferSize bytes, so a file larger than the memory is processed in constant memory.
+    /// If sequential is true, the kernel is advised to read ahead (posix_fadvise on Linux). It returns false on a read error.
+    bool cat(const QString& file, const CatCallback& callback, int bufferSize = 64 * 1024, bool sequential = true);
+
+    /// Write a file to the sink in chunks. It returns false on a read or write error.
+    bool cat(const QString& file, QIODevice* sink, int bufferSize = 64 * 1024, bool sequential = true);
+
+    /// Read a file as raw bytes, without decoding it to QString
+    QByteArray catBytes(const QString& file);
+
+    /// A read-only memory mapping of a whole file. Its content is loaded by page faults on access instead of being copied.
+    /// If another process truncates the file meanwhile, an access beyond the new end raises SIGBUS.
+    class MappedFile {
+    public:
+        explicit MappedFile(const QString& file);
+
+        ~MappedFile();
+
+        /// False if the file could not be opened
+        bool isValid() const;
+
+        qint64 size() const;
+
+        /// The mapped content. It is null if the file is empty or could not be mapped (e.g. a compressed resource)
+        const char* constData() const;
+
+        /// A QByteArray referencing the mapping without a copy. It must not be used after the MappedFile is destroyed.
+        /// If the file could not be mapped, it is a copy read from the file. A file larger than 2GB does not fit in a QByteArray,
+        /// so it returns a null QByteArray. Use constData() and size() for such a file.
+        QByteArray bytes() const;
+
+    private:
+        Q_DISABLE_COPY(MappedFile)
+
+        class Data;
+        Data* d;
+    };
+
     // Implementation of `realpath -s`, return the canonicalised absolute pathname without resolving the symbolic link
     QString realpath_strip(const QString& input);
 
@@ -63,7 +491,15 @@ namespace QtShell {
         return realpath_strip(realpath_strip(basePath, subPath), args...);
     }
 
+    /// Locate a program in the directories of PATH. The lookups are cached until PATH or the modification time of a directory is changed.
+    /// The permission of a cached file is checked again on every call.
     QString which(const QString& program);
+
+    /// Options: "-a" lists all the matches in the order of PATH
+    QStringList which(const QString& options, const QString& program);
+
+    /// Locate a list of programs. The result has the same order, with an empty string for a program not found
+    QStringList which(const QStringList& programs);
 }
 
 #endif // QTSHELL_H
@@ -6,10 +6,29 @@ CONFIG += c++11
 HEADERS += \
     $$PWD/qtshell.h \
     $$PWD/QtShell \
-    $$PWD/priv/qtshellpriv.h
+    $$PWD/priv/qtshellpriv.h \
+    $$PWD/priv/qtshellpool.h \
+    $$PWD/priv/qtshelldirent.h \
+    $$PWD/priv/qtshellfind.h \
+    $$PWD/priv/qtshellcopy.h \
+    $$PWD/priv/qtshellprogress.h
 
 SOURCES += \
     $$PWD/qtshell.cpp \
     $$PWD/priv/qtshellpriv.cpp \
     $$PWD/priv/qtshellmv.cpp \
-    $$PWD/priv/qtshellrealpath.cpp
+    $$PWD/priv/qtshellrm.cpp \
+    $$PWD/priv/qtshellwhich.cpp \
+    $$PWD/priv/qtshellcat.cpp \
+    $$PWD/priv/qtshellrealpath.cpp \
+    $$PWD/priv/qtshellfind.cpp \
+    $$PWD/priv/qtshellpool.cpp \
+    $$PWD/priv/qtshellglob.cpp \
+    $$PWD/priv/qtshelldirent.cpp \
+    $$PWD/priv/qtshellfindresult.cpp \
+    $$PWD/priv/qtshellfindindex.cpp \
+    $$PWD/priv/qtshellfindasync.cpp \
+    $$PWD/priv/qtshellcopy.cpp \
+    $$PWD/priv/qtshellcp.cpp \
+    $$PWD/priv/qtshellprogress.cpp \
+    $$PWD/priv/qtshelljournal.cpp
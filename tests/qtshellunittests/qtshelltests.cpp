@@ -2,9 +2,18 @@
 #include <QTest>
 #include <Automator>
 #include <QDir>
+#include <QThreadPool>
+#include <QStorageInfo>
+#include <QBuffer>
 #include "qtshelltests.h"
 #include "qtshell.h"
 #include "priv/qtshellpriv.h"
+#include "priv/qtshellfind.h"
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
 
 using namespace QtShell;
 using namespace QtShell::Private;
@@ -209,6 +218,389 @@ void QtShellTests::test_find_options()
 
 }
 
+void QtShellTests::test_find_threads()
+{
+    QString folder = realpath_strip(pwd(), QTest::currentTestFunction());
+    rm("-rf", folder);
+    for (int i = 0 ; i < 4 ; i++) {
+        mkdir("-p", QString("%1/%2/sub").arg(folder).arg(i));
+        touch(QString("%1/%2/file.txt").arg(folder).arg(i));
+        touch(QString("%1/%2/sub/file.md").arg(folder).arg(i));
+    }
+
+    FindOptions options;
+    QStringList expected = find(options, folder);
+    QCOMPARE(expected.size(), 17);
+
+    options.threads = 4;
+    QStringList files = find(options, folder);
+    QCOMPARE(files.size(), expected.size());
+    files.sort();
+    QStringList sorted = expected;
+    sorted.sort();
+    QVERIFY(files == sorted);
+
+    options.ordered = true;
+    QVERIFY(find(options, folder) == expected);
+
+    options.maxdepth = 2;
+    QCOMPARE(find(options, folder).size(), 13);
+
+    options.threads = 0;
+    QCOMPARE(find(options, folder, QStringList() << "*.md").size(), 0);
+
+    options.maxdepth = -1;
+    QCOMPARE(find(options, folder, QStringList() << "*.md").size(), 4);
+}
+
+void QtShellTests::test_find_visitor()
+{
+    QString folder = realpath_strip(pwd(), QTest::currentTestFunction());
+    rm("-rf", folder);
+    mkdir("-p", folder + "/A/A1");
+    mkdir("-p", folder + "/B");
+    touch(folder + "/file1.txt");
+    touch(folder + "/A/file2.txt");
+    touch(folder + "/A/A1/file3.txt");
+    touch(folder + "/B/file4.txt");
+
+    FindOptions options;
+    QStringList paths;
+    FindEntry file1;
+    FindEntry dirA;
+
+    QVERIFY(find(options, folder, QStringList(), [&](const FindEntry& entry) {
+        paths << entry.path;
+        if (entry.fileName == "file1.txt") {
+            file1 = entry;
+        } else if (entry.fileName == "A") {
+            dirA = entry;
+        }
+        return FindContinue;
+    }));
+    QVERIFY(paths == find(folder));
+    QCOMPARE(file1.type, FindEntry::File);
+    QCOMPARE(file1.depth, 1);
+    QCOMPARE(file1.info().size(), (qint64) 0);
+    QCOMPARE(dirA.type, FindEntry::Dir);
+
+    // Stop
+    paths.clear();
+    QVERIFY(!find(options, folder, QStringList() << "*.txt", [&](const FindEntry& entry) {
+        paths << entry.path;
+        return FindStop;
+    }));
+    QCOMPARE(paths.size(), 1);
+
+    // Prune
+    for (int threads = 1 ; threads <= 2 ; threads++) {
+        options.threads = threads;
+        options.ordered = true;
+        paths.clear();
+        QVERIFY(find(options, folder, QStringList(), [&](const FindEntry& entry) {
+            paths << entry.fileName;
+            return entry.fileName == "A" ? FindPrune : FindContinue;
+        }));
+        QCOMPARE(paths.size(), 5);
+        QVERIFY(paths.indexOf("A") >= 0);
+        QVERIFY(paths.indexOf("file2.txt") < 0);
+    }
+
+    // The ordered parallel walk does not list a pruned directory, and stops listing on FindStop
+    for (int i = 0 ; i < 100 ; i++) {
+        mkdir("-p", QString("%1/C/%2").arg(folder).arg(i));
+    }
+
+    QStringList listed;
+    QMutex mutex;
+    options.threads = 2;
+    options.ordered = true;
+
+    FindWalker walker(options, folder, GlobMatcher());
+    walker.setLister([&](const QString& path, QList<DirEntry>& entries) {
+        {
+            QMutexLocker locker(&mutex);
+            listed << QtShell::basename(path);
+        }
+        return readDir(path, entries);
+    });
+
+    QVERIFY(walker.run([&](const FindEntry& entry) {
+        return entry.fileName == "A" || entry.fileName == "C" ? FindPrune : FindContinue;
+    }));
+    QVERIFY(!listed.contains("A"));
+    QVERIFY(!listed.contains("A1"));
+    QVERIFY(!listed.contains("C"));
+
+    listed.clear();
+    FindWalker stopWalker(options, folder + "/C", GlobMatcher());
+    stopWalker.setLister([&](const QString& path, QList<DirEntry>& entries) {
+        {
+            QMutexLocker locker(&mutex);
+            listed << QtShell::basename(path);
+        }
+        return readDir(path, entries);
+    });
+
+    QVERIFY(!stopWalker.run([&](const FindEntry&) {
+        return FindStop;
+    }));
+    QCOMPARE(listed, QStringList() << "C");
+}
+
+void QtShellTests::test_find_sorted()
+{
+    QString folder = realpath_strip(pwd(), QTest::currentTestFunction());
+    rm("-rf", folder);
+    mkdir("-p", folder + "/b");
+    touch(folder + "/C.txt");
+    touch(folder + "/a.txt");
+    touch(folder + "/b/d.txt");
+    touch(folder + "/.hidden");
+
+    FindOptions options;
+    QStringList files = find(options, folder);
+    QCOMPARE(files.size(), 5);
+    QCOMPARE(files[1], folder + "/a.txt");
+    QCOMPARE(files[2], folder + "/b");
+    QCOMPARE(files[3], folder + "/C.txt");
+
+    options.sorted = false;
+    QStringList unsorted = find(options, folder);
+    QCOMPARE(unsorted.size(), 5);
+    files.sort();
+    unsorted.sort();
+    QVERIFY(files == unsorted);
+}
+
+void QtShellTests::test_find_result()
+{
+    QString folder = realpath_strip(pwd(), QTest::currentTestFunction());
+    rm("-rf", folder);
+    mkdir("-p", folder + "/A/A1");
+    touch(folder + "/file1.txt");
+    touch(folder + "/A/file2.txt");
+    touch(folder + "/A/A1/file3.md");
+
+    FindOptions options;
+    FindResult result;
+
+    QVERIFY(find(options, folder, QStringList(), result));
+    QCOMPARE(result.size(), 6);
+    QVERIFY(result.toStringList() == find(folder));
+    QCOMPARE(result.at(0), folder);
+    QCOMPARE(result.at(5), folder + "/A/A1/file3.md");
+    QCOMPARE(result.fileName(5), QString("file3.md"));
+
+    QVERIFY(find(options, QString(QTest::currentTestFunction()) + "/", QStringList() << "*.txt", result));
+    QCOMPARE(result.size(), 2);
+    QVERIFY(result.toStringList() == find(QString(QTest::currentTestFunction()) + "/", "*.txt"));
+
+    options.threads = 2;
+    QVERIFY(find(options, folder, QStringList() << "*.md", result));
+    QCOMPARE(result.size(), 1);
+    QCOMPARE(result.at(0), folder + "/A/A1/file3.md");
+
+#ifdef Q_OS_UNIX
+    options.threads = 1;
+    options.maxdepth = 1;
+    QVERIFY(find(options, "/", QStringList() << "tmp", result));
+    QCOMPARE(result.size(), 1);
+    QCOMPARE(result.at(0), QString("/tmp"));
+#endif
+}
+
+void QtShellTests::test_find_predicates()
+{
+    QString folder = realpath_strip(pwd(), QTest::currentTestFunction());
+    rm("-rf", folder);
+    mkdir("-p", folder + "/A/A1");
+    mkdir("-p", folder + "/skip");
+    touch(folder + "/file1.txt");
+    touch(folder + "/A/file2.txt");
+    touch(folder + "/A/A1/file3.txt");
+    touch(folder + "/skip/file4.txt");
+
+    QFile file(folder + "/A/data.bin");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(100, 'x'));
+    file.close();
+
+    {
+        FindOptions options;
+        options.type = "f";
+        QCOMPARE(find(options, folder).size(), 5);
+
+        options.type = "d";
+        QCOMPARE(find(options, folder).size(), 4);
+    }
+
+    {
+        FindOptions options;
+        options.mindepth = 2;
+        QCOMPARE(find(options, folder).size(), 5);
+
+        options.maxdepth = 2;
+        QCOMPARE(find(options, folder).size(), 4);
+    }
+
+    {
+        FindOptions options;
+        options.minsize = 1;
+        options.type = "f";
+        QStringList files = find(options, folder);
+        QCOMPARE(files.size(), 1);
+        QCOMPARE(files[0], folder + "/A/data.bin");
+
+        options.minsize = -1;
+        options.maxsize = 0;
+        QCOMPARE(find(options, folder).size(), 4);
+    }
+
+    {
+        FindOptions options;
+        options.type = "f";
+        options.newer = QDateTime::currentDateTime().addDays(-1);
+        QCOMPARE(find(options, folder).size(), 5);
+
+        options.newer = QDateTime::currentDateTime().addDays(1);
+        QCOMPARE(find(options, folder).size(), 0);
+
+        options.newer = QDateTime();
+        options.older = QDateTime::currentDateTime().addDays(-1);
+        QCOMPARE(find(options, folder).size(), 0);
+    }
+
+    {
+        FindOptions options;
+        options.prune << "skip";
+        QStringList files = find(options, folder);
+        QCOMPARE(files.size(), 7);
+        QCOMPARE(files.filter("skip").size(), 0);
+    }
+
+    {
+        FindOptions options;
+        options.limit = 2;
+        QCOMPARE(find(options, folder, QStringList() << "*.txt").size(), 2);
+
+        options.limit = 0;
+        QCOMPARE(find(options, folder).size(), 0);
+    }
+}
+
+void QtShellTests::test_findIndex()
+{
+    QString folder = realpath_strip(pwd(), QTest::currentTestFunction());
+    rm("-rf", folder);
+    mkdir("-p", folder + "/A/A1");
+    touch(folder + "/file1.txt");
+    touch(folder + "/A/file2.txt");
+
+    FindIndex index(folder);
+    QCOMPARE(index.root(), folder);
+    QVERIFY(index.find() == find(folder));
+    QVERIFY(index.find() == find(folder));
+    QCOMPARE(index.find(QStringList() << "*.txt").size(), 2);
+
+    FindOptions options;
+    options.maxdepth = 1;
+    QVERIFY(index.find(options) == find(options, folder));
+
+    touch(folder + "/A/A1/file3.txt");
+    QCOMPARE(index.find(QStringList() << "*.txt").size(), 3);
+
+    rm("-rf", folder + "/A");
+    QCOMPARE(index.find(QStringList() << "*.txt").size(), 1);
+
+    mkdir("-p", folder + "/B");
+    touch(folder + "/B/file4.txt");
+    QVERIFY(index.find() == find(folder));
+
+    index.clear();
+    QVERIFY(index.find() == find(folder));
+
+#ifdef Q_OS_UNIX
+    // A directory reached through a link is invalidated for every path, whichever path is changed
+    mkdir("-p", folder + "/real");
+    touch(folder + "/real/file5.txt");
+    QVERIFY(QFile::link(folder + "/real", folder + "/link"));
+    QCOMPARE(index.find(QStringList() << "file5.txt").size(), 2);
+
+    touch(folder + "/real/file6.txt");
+    QCOMPARE(index.find(QStringList() << "file6.txt").size(), 2);
+    QVERIFY(index.find() == find(folder));
+
+    rm(folder + "/real/file6.txt");
+    QCOMPARE(index.find(QStringList() << "file6.txt").size(), 0);
+    QVERIFY(index.find() == find(folder));
+#endif
+}
+
+void QtShellTests::test_findAsync()
+{
+    QString folder = realpath_strip(pwd(), QTest::currentTestFunction());
+    rm("-rf", folder);
+    for (int i = 0 ; i < 10 ; i++) {
+        mkdir("-p", QString("%1/%2").arg(folder).arg(i));
+        touch(QString("%1/%2/file.txt").arg(folder).arg(i));
+    }
+
+    FindOptions options;
+    QFuture<QString> future = findAsync(options, folder);
+    future.waitForFinished();
+    QVERIFY(QStringList(future.results()) == find(options, folder));
+
+    QThreadPool pool;
+    future = findAsync(options, folder, QStringList() << "*.txt", &pool);
+    future.waitForFinished();
+    QCOMPARE(future.results().size(), 10);
+
+    future = findAsync(options, folder, QStringList(), &pool);
+    future.cancel();
+    future.waitForFinished();
+    QVERIFY(future.isCanceled());
+}
+
+void QtShellTests::test_globMatcher()
+{
+    QFETCH(QString, pattern);
+    QFETCH(QString, fileName);
+
+    QRegExp rx(pattern, Qt::CaseInsensitive, QRegExp::Wildcard);
+    QCOMPARE(GlobMatcher(pattern).match(fileName), rx.exactMatch(fileName));
+}
+
+void QtShellTests::test_globMatcher_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<QString>("fileName");
+
+    QTest::newRow("literal") << "main.cpp" << "main.cpp";
+    QTest::newRow("literal-case") << "MAIN.cpp" << "main.CPP";
+    QTest::newRow("literal-mismatch") << "main.cpp" << "main.cp";
+    QTest::newRow("suffix") << "*.txt" << "a.txt";
+    QTest::newRow("suffix-case") << "*.txt" << "A.TXT";
+    QTest::newRow("suffix-mismatch") << "*.txt" << "a.md";
+    QTest::newRow("suffix-empty") << "*.txt" << "";
+    QTest::newRow("prefix") << "a*" << "abc";
+    QTest::newRow("prefix-mismatch") << "a*" << "bac";
+    QTest::newRow("everything") << "*" << "abc";
+    QTest::newRow("everything-empty") << "*" << "";
+    QTest::newRow("middle") << "a*.txt" << "a1.txt";
+    QTest::newRow("middle-mismatch") << "a*.txt" << "b2.txt";
+    QTest::newRow("question") << "?.txt" << "a.txt";
+    QTest::newRow("question-mismatch") << "?.txt" << "ab.txt";
+    QTest::newRow("backtrack") << "*a*b" << "xaxxab";
+    QTest::newRow("backtrack-mismatch") << "*a*b" << "xaxxa";
+    QTest::newRow("set") << "[abc].txt" << "b.txt";
+    QTest::newRow("set-range") << "file[0-9].txt" << "file7.txt";
+    QTest::newRow("set-range-case") << "[a-c]*" << "Cat";
+    QTest::newRow("set-negated") << "[^a]*" << "abc";
+    QTest::newRow("set-negated-match") << "[^a]*" << "bc";
+    QTest::newRow("set-bracket") << "[]]" << "]";
+}
+
 void QtShellTests::test_rmdir()
 {
     QDir dir("tmp");
@@ -300,6 +692,127 @@ void QtShellTests::test_rm()
 
 }
 
+void QtShellTests::test_rm_parallel()
+{
+    rm("-rf", "tmp");
+
+    for (int i = 0 ; i < 8 ; i++) {
+        QString path = QString("tmp/%1/a/b/c").arg(i);
+        mkdir("-p", path);
+        touch(path + "/1.txt");
+        touch(path + "/.hidden");
+        touch(QString("tmp/%1/a/2.txt").arg(i));
+    }
+
+    // A link to a directory is removed, but not the files of its target
+    mkdir("-p", "linked");
+    touch("linked/1.txt");
+    QVERIFY(QFile::link(QtShell::pwd() + "/linked", "tmp/0/link"));
+
+    QVERIFY(rm("-rf -j 4", "tmp"));
+    QVERIFY(!QFileInfo::exists("tmp"));
+    QVERIFY(QFileInfo::exists("linked/1.txt"));
+
+    QVERIFY(!rm("-rf -j x", "linked"));
+    QVERIFY(rm("-rf -j 0", "linked"));
+    QVERIFY(!QFileInfo::exists("linked"));
+
+#ifdef Q_OS_LINUX
+    // A wide tree does not hold an fd per queued directory
+    for (int i = 0 ; i < 1000 ; i++) {
+        QString path = QString("tmp/%1/a").arg(i);
+        mkdir("-p", path);
+        touch(path + "/1.txt");
+    }
+
+    int baseline = QDir("/proc/self/fd").count();
+    int maxOpen = 0;
+    QMutex mutex;
+    Progress progress([&](const ProgressInfo&) {
+        QMutexLocker locker(&mutex);
+        maxOpen = qMax(maxOpen, (int) QDir("/proc/self/fd").count());
+    }, 0);
+
+    QVERIFY(rm("-rf -j 4", "tmp", progress));
+    QVERIFY(!QFileInfo::exists("tmp"));
+    QVERIFY(maxOpen - baseline < 200);
+#endif
+}
+
+void QtShellTests::test_rm_preserved()
+{
+    rm("-rf", "tmp");
+    mkdir("-p", "tmp/keep/sub");
+    touch("tmp/keep/sub/1.txt");
+    touch("tmp/2.txt");
+
+    QString keep = QtShell::pwd() + "/tmp/keep/";
+    addPreservedPath(keep);
+    QVERIFY(preservedPaths().contains(QtShell::pwd() + "/tmp/keep"));
+    QVERIFY(preservedPaths().contains("/"));
+
+    // Skipped at the top level
+    QVERIFY(rm("-rf", "tmp/keep"));
+    QVERIFY(QFileInfo::exists("tmp/keep/sub/1.txt"));
+
+    // Kept inside a tree
+    QVERIFY(!rm("-rf -j 2", "tmp"));
+    QVERIFY(QFileInfo::exists("tmp/keep/sub/1.txt"));
+    QVERIFY(!QFileInfo::exists("tmp/2.txt"));
+
+    // The changes survive a refresh
+    refreshPreservedPaths();
+    QVERIFY(preservedPaths().contains(QtShell::pwd() + "/tmp/keep"));
+
+    removePreservedPath(keep);
+    QVERIFY(!preservedPaths().contains(QtShell::pwd() + "/tmp/keep"));
+    QVERIFY(rm("-rf", "tmp"));
+    QVERIFY(!QFileInfo::exists("tmp"));
+}
+
+void QtShellTests::test_rm_defer()
+{
+    rm("-rf", "tmp");
+    mkdir("-p", "tmp/a/b");
+    touch("tmp/a/b/1.txt");
+    touch("tmp/2.txt");
+
+    QVERIFY(!rm("--defer", "tmp")); // rm: tmp: is a directory
+    QVERIFY(QFileInfo::exists("tmp"));
+
+    QVERIFY(rm("-rf --defer", "tmp"));
+    QVERIFY(!QFileInfo::exists("tmp"));
+
+    touch("3.txt");
+    QVERIFY(rm("--defer", "3.txt"));
+    QVERIFY(!QFileInfo::exists("3.txt"));
+
+    QVERIFY(waitForTrash(30000));
+
+    // The trash is at the top of the file system (e.g. when run as root) or in the cache directory of the user.
+    // If neither is on the file system of the current directory, the entries were removed in place
+    QString trash = trashPath(QtShell::pwd() + "/tmp");
+    QVERIFY(trash != QtShell::pwd() + "/.qtshell-trash" || QtShell::pwd() == "/");
+
+    // Other processes may share the trash. Only the entries of this process are checked
+    QString pid = QString(".%1.").arg(QCoreApplication::applicationPid());
+    foreach (QString name, QDir(trash).entryList(QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot)) {
+        QVERIFY2(!name.contains(pid), qPrintable(name));
+    }
+
+    // A directory holding a preserved path is removed now, and the preserved path is kept
+    mkdir("-p", "tmp/keep");
+    touch("tmp/keep/1.txt");
+    touch("tmp/2.txt");
+    QString keep = QtShell::pwd() + "/tmp/keep";
+    addPreservedPath(keep);
+    QVERIFY(!rm("-rf --defer", "tmp"));
+    QVERIFY(QFileInfo::exists("tmp/keep/1.txt"));
+    QVERIFY(!QFileInfo::exists("tmp/2.txt"));
+    removePreservedPath(keep);
+    QVERIFY(rm("-rf", "tmp"));
+}
+
 void QtShellTests::test_mkdir()
 {
     QDir dir("tmp");
@@ -378,7 +891,42 @@ void QtShellTests::test_cp_overwrite()
 
     QVERIFY(cp("src/*.txt","target"));
 
+    // The target is replaced by rename, no temporary file is left
+    QFile file("src/1.txt");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("new content");
+    file.close();
+
+    QVERIFY(cp("src/1.txt","target"));
+    QCOMPARE(cat("target/1.txt"), QString("new content"));
+    QCOMPARE(QDir("target").entryList(QDir::Files | QDir::Hidden).size(), 2);
 
+    // A failed copy keeps the original target and leaves no temporary file
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("newer content");
+    file.close();
+
+#ifdef Q_OS_UNIX
+    QVERIFY(QFile::setPermissions("src/1.txt", 0));
+    QFile probe("src/1.txt");
+
+    // root could still read it
+    if (!probe.open(QIODevice::ReadOnly)) {
+        QVERIFY(!cp("src/1.txt", "target"));
+        QCOMPARE(cat("target/1.txt"), QString("new content"));
+        QCOMPARE(QDir("target").entryList(QDir::Files | QDir::Hidden).size(), 2);
+    }
+    probe.close();
+    QVERIFY(QFile::setPermissions("src/1.txt", QFile::ReadOwner | QFile::WriteOwner));
+#endif
+
+    // A file system without reflink fails the copy after the temporary file is created
+    if (!cp("--reflink=always", "src/1.txt", "target")) {
+        QCOMPARE(cat("target/1.txt"), QString("new content"));
+    } else {
+        QCOMPARE(cat("target/1.txt"), QString("newer content"));
+    }
+    QCOMPARE(QDir("target").entryList(QDir::Files | QDir::Hidden).size(), 2);
 }
 
 void QtShellTests::test_cp_recursive()
@@ -419,6 +967,372 @@ void QtShellTests::test_cp_log()
     QVERIFY(record.second == "target/1/1.txt");
 }
 
+void QtShellTests::test_cp_content()
+{
+    rm("-rf", "src");
+    rm("-rf", "target");
+    mkdir("src");
+    mkdir("target");
+
+    QByteArray content;
+    for (int i = 0 ; i < 3 * 1024 * 1024 ; i++) {
+        content.append((char) (i % 251));
+    }
+
+    QFile file("src/data.bin");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(content);
+    file.close();
+    QVERIFY(file.setPermissions(QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner));
+
+    QVERIFY(cp("src/data.bin", "target"));
+
+    QFile copied("target/data.bin");
+    QVERIFY(copied.open(QIODevice::ReadOnly));
+    QVERIFY(copied.readAll() == content);
+    copied.close();
+    QVERIFY(copied.permissions() & QFile::ExeOwner);
+
+    touch("src/empty.txt");
+    QVERIFY(cp("src/empty.txt", "target"));
+    QCOMPARE(QFileInfo("target/empty.txt").size(), (qint64) 0);
+
+    QVERIFY(!cp("src/not-existed.bin", "target"));
+}
+
+void QtShellTests::test_cp_sparse()
+{
+    rm("-rf", "src");
+    rm("-rf", "target");
+    mkdir("src");
+    mkdir("target");
+
+    const qint64 size = 64 * 1024 * 1024;
+
+    // data, hole, data, hole
+    QFile file("src/sparse.bin");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(4096, 'a'));
+    QVERIFY(file.seek(size / 2));
+    file.write(QByteArray(4096, 'b'));
+    QVERIFY(file.resize(size));
+    file.close();
+
+    QVERIFY(cp("src/sparse.bin", "target"));
+
+    QFile copied("target/sparse.bin");
+    QCOMPARE(copied.size(), size);
+    QVERIFY(copied.open(QIODevice::ReadOnly));
+    QCOMPARE(copied.read(4096), QByteArray(4096, 'a'));
+    QCOMPARE(copied.read(4096), QByteArray(4096, 0));
+    QVERIFY(copied.seek(size / 2));
+    QCOMPARE(copied.read(4096), QByteArray(4096, 'b'));
+    QVERIFY(copied.seek(size - 4096));
+    QCOMPARE(copied.read(4096), QByteArray(4096, 0));
+    copied.close();
+
+#ifdef Q_OS_UNIX
+    // The holes are kept, so only a few blocks are allocated
+    struct stat st;
+    QCOMPARE(::stat("src/sparse.bin", &st), 0);
+    if ((qint64) st.st_blocks * 512 >= size / 2) {
+        QSKIP("The file system does not support sparse files");
+    }
+
+    QCOMPARE(::stat("target/sparse.bin", &st), 0);
+    QVERIFY((qint64) st.st_blocks * 512 < size / 8);
+#endif
+}
+
+void QtShellTests::test_cp_link()
+{
+    rm("-rf", "src");
+    rm("-rf", "target");
+    mkdir("-p", "src/1");
+    mkdir("target");
+
+    auto write = [](const QString& file, const QByteArray& content) {
+        QFile f(file);
+        f.open(QIODevice::WriteOnly);
+        f.write(content);
+    };
+
+    write("src/1/a.txt", "a");
+
+    QVERIFY(cp("-a -l", "src/*", "target"));
+    QCOMPARE(cat("target/1/a.txt"), QString("a"));
+
+    // Same file
+    write("src/1/a.txt", "b");
+    QCOMPARE(cat("target/1/a.txt"), QString("b"));
+
+    // Link again over the existing target
+    QVERIFY(cp("-a -l", "src/*", "target"));
+    QCOMPARE(QDir("target/1").entryList(QDir::Files | QDir::Hidden).size(), 1);
+
+    QVERIFY(cp("-a --reflink=never", "src/*", "target"));
+    write("src/1/a.txt", "c");
+    QCOMPARE(cat("target/1/a.txt"), QString("b"));
+
+    QVERIFY(cp("-a --reflink=auto", "src/*", "target"));
+    QCOMPARE(cat("target/1/a.txt"), QString("c"));
+
+    QVERIFY(!cp("-a --reflink=sometimes", "src/*", "target"));
+}
+
+void QtShellTests::test_cp_threads()
+{
+    rm("-rf", "src");
+    rm("-rf", "target1");
+    rm("-rf", "target2");
+
+    for (int i = 0 ; i < 10 ; i++) {
+        mkdir("-p", QString("src/%1/sub").arg(i));
+        for (int j = 0 ; j < 20 ; j++) {
+            QFile file(QString("src/%1/sub/%2.txt").arg(i).arg(j));
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write(QString("%1-%2").arg(i).arg(j).toUtf8());
+        }
+    }
+    mkdir("target1");
+    mkdir("target2");
+
+    QList<QPair<QString,QString> > log1;
+    QList<QPair<QString,QString> > log2;
+
+    QVERIFY(cp("-a", "src/*", "target1", log1));
+    QVERIFY(cp("-a -j 4", "src/*", "target2", log2));
+
+    QCOMPARE(log2.size(), 200);
+
+    // Same order as a single thread copy
+    for (int i = 0 ; i < log1.size() ; i++) {
+        QCOMPARE(log2[i].first, log1[i].first);
+    }
+
+    QCOMPARE(cat("target2/9/sub/19.txt"), QString("9-19"));
+
+    QVERIFY(!cp("-j x", "src/0/sub/0.txt", "target2"));
+}
+
+void QtShellTests::test_cp_update()
+{
+    rm("-rf", "src");
+    rm("-rf", "target");
+    mkdir("-p", "src/1");
+    mkdir("target");
+
+    auto write = [](const QString& file, const QByteArray& content) {
+        QFile f(file);
+        f.open(QIODevice::WriteOnly);
+        f.write(content);
+    };
+
+    write("src/1/a.txt", "a");
+    write("src/1/b.txt", "b");
+
+    QList<QPair<QString,QString> > log;
+    QVERIFY(cp("-a -u", "src/*", "target", log));
+    QCOMPARE(log.size(), 2);
+
+    // Nothing changed
+    log.clear();
+    QVERIFY(cp("-a -u", "src/*", "target", log));
+    QCOMPARE(log.size(), 0);
+
+    // Size changed
+    write("src/1/b.txt", "bb");
+    log.clear();
+    QVERIFY(cp("-a -u", "src/*", "target", log));
+    QCOMPARE(log.size(), 1);
+    QCOMPARE(log.first().second, QString("target/1/b.txt"));
+
+    // Same size and newer target, only caught by checksum
+    write("target/1/a.txt", "x");
+    log.clear();
+    QVERIFY(cp("-a -u", "src/*", "target", log));
+    QCOMPARE(log.size(), 0);
+    QVERIFY(cp("-a -c", "src/*", "target", log));
+    QCOMPARE(log.size(), 1);
+    QCOMPARE(cat("target/1/a.txt"), QString("a"));
+
+    // Extraneous files
+    write("target/1/c.txt", "c");
+    mkdir("target/1/d");
+    touch("target/1/d/e.txt");
+    QVERIFY(cp("-a -u", "src/*", "target"));
+    QVERIFY(QFile::exists("target/1/c.txt"));
+    QVERIFY(cp("-a -u --delete", "src/*", "target"));
+    QVERIFY(!QFile::exists("target/1/c.txt"));
+    QVERIFY(!QFile::exists("target/1/d"));
+    QVERIFY(QFile::exists("target/1/a.txt"));
+
+    // Hidden extraneous files are deleted too
+    write("target/1/.hidden", "hidden");
+    QVERIFY(cp("-a -u --delete", "src/*", "target"));
+    QVERIFY(!QFileInfo::exists("target/1/.hidden"));
+
+    // A link to a directory is deleted, but not the files it points to
+    rm("-rf", "outside");
+    mkdir("outside");
+    write("outside/keep.txt", "keep");
+    QVERIFY(QFile::link(QtShell::pwd() + "/outside", "target/1/link"));
+    QVERIFY(cp("-a -u --delete", "src/*", "target"));
+    QVERIFY(!QFileInfo("target/1/link").isSymLink());
+    QVERIFY(QFileInfo::exists("outside/keep.txt"));
+    rm("-rf", "outside");
+}
+
+void QtShellTests::test_extract()
+{
+    rm("-rf", "target");
+
+    QVERIFY(extract(":/extract", "target"));
+    QCOMPARE(find("target", "*.cpp").size(), 1);
+    QCOMPARE(find("target", "*.h").size(), 1);
+    QVERIFY(QFile::exists("target/.qtshell-manifest"));
+
+    QFile original(":/extract/main.cpp");
+    QVERIFY(original.open(QIODevice::ReadOnly));
+    QCOMPARE(cat("target/main.cpp"), QString::fromUtf8(original.readAll()));
+
+    // Unchanged resource set. Nothing is extracted again
+    QFile::setPermissions("target/main.cpp", QFile::ReadOwner | QFile::WriteOwner);
+    QVERIFY(rm("target/main.cpp"));
+    QVERIFY(extract(":/extract", "target"));
+    QVERIFY(!QFile::exists("target/main.cpp"));
+
+    QVERIFY(rm("target/.qtshell-manifest"));
+    QVERIFY(extract(":/extract", "target", 2));
+    QVERIFY(QFile::exists("target/main.cpp"));
+
+    QVERIFY(!extract(":/not-existed", "target"));
+}
+
+void QtShellTests::test_progress()
+{
+    rm("-rf", "src");
+    rm("-rf", "target");
+    mkdir("-p", "src/1");
+    mkdir("target");
+
+    for (int i = 0 ; i < 10 ; i++) {
+        QFile file(QString("src/1/%1.bin").arg(i));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(QByteArray(1000, 'x'));
+    }
+
+    QList<ProgressInfo> infos;
+    Progress progress([&](const ProgressInfo& info) {
+        infos << info;
+    }, 0, true);
+
+    QVERIFY(cp("-a -j 2", "src/*", "target", progress));
+    QVERIFY(infos.size() >= 3);
+    QCOMPARE(infos.first().phase, ProgressInfo::Scan);
+
+    ProgressInfo info = progress.info();
+    QCOMPARE(info.phase, ProgressInfo::Finished);
+    QCOMPARE(info.files, (qint64) 10);
+    QCOMPARE(info.bytes, (qint64) 10000);
+    QCOMPARE(info.totalFiles, (qint64) 10);
+    QCOMPARE(info.totalBytes, (qint64) 10000);
+
+    QVERIFY(mv("target/1", "target/2", progress));
+    QCOMPARE(progress.info().files, (qint64) 1);
+
+    QVERIFY(rm("-rf", "target/2", progress));
+    QCOMPARE(progress.info().files, (qint64) 10);
+    QCOMPARE(progress.info().totalBytes, (qint64) 10000);
+    QVERIFY(!QFile::exists("target/2"));
+
+    // Without scan
+    Progress quiet(Progress::Callback(), 1000);
+    QVERIFY(cp("-a", "src/*", "target", quiet));
+    QCOMPARE(quiet.info().files, (qint64) 10);
+    QCOMPARE(quiet.info().totalFiles, (qint64) -1);
+
+    // The callback may read the progress itself
+    rm("-rf", "target");
+    qint64 lastFiles = -1;
+    Progress* self = 0;
+    Progress reentrant([&](const ProgressInfo&) {
+        lastFiles = self->info().files;
+    }, 0);
+    self = &reentrant;
+    QVERIFY(cp("-a -j 4", "src", "target", reentrant));
+    QCOMPARE(lastFiles, (qint64) 10);
+
+#ifdef Q_OS_UNIX
+    // cp follows a link to a directory, so the scan counts its content too
+    rm("-rf", "target");
+    mkdir("target");
+    QVERIFY(QFile::link("1", "src/link"));
+    QVERIFY(cp("-a", "src/*", "target", progress));
+    info = progress.info();
+    QCOMPARE(info.files, (qint64) 20);
+    QCOMPARE(info.totalFiles, (qint64) 20);
+    QCOMPARE(info.totalBytes, (qint64) 20000);
+#endif
+}
+
+void QtShellTests::test_journal()
+{
+    MemoryJournal memory;
+    memory.append("src/1/a.txt", "target/1/a.txt");
+    memory.append("src/1/b.txt", "target/1/c.txt");
+    memory.append("a.txt", "/a.txt");
+    QCOMPARE(memory.size(), 3);
+    QCOMPARE(memory.at(0), qMakePair(QString("src/1/a.txt"), QString("target/1/a.txt")));
+    QCOMPARE(memory.at(1), qMakePair(QString("src/1/b.txt"), QString("target/1/c.txt")));
+    QCOMPARE(memory.at(2), qMakePair(QString("a.txt"), QString("/a.txt")));
+
+    rm("-rf", "src");
+    rm("-rf", "target");
+    mkdir("-p", "src/1");
+    mkdir("-p", "src/2");
+    touch("src/1/1.txt");
+    touch("src/2/1.txt");
+    touch("src/2/2.txt");
+    mkdir("target");
+
+    QList<QPair<QString,QString> > log;
+    QVERIFY(cp("-a", "src/*", "target", log));
+    rm("-rf", "target");
+    mkdir("target");
+
+    memory.clear();
+    QVERIFY(cp("-a", "src/*", "target", memory));
+    QCOMPARE(memory.toList(), log);
+
+    rm("-f", "journal.txt");
+    {
+        FileJournal journal("journal.txt");
+        QVERIFY(journal.open());
+        QVERIFY(cp("-a", "src/*", "target", journal));
+        journal.append("with\ttab\\", "with\nnewline");
+        QVERIFY(journal.flush());
+        QVERIFY(!journal.hasError());
+    }
+
+    QList<QPair<QString,QString> > replayed;
+    QVERIFY(FileJournal::replay("journal.txt", [&](const QString& source, const QString& target) {
+        replayed << qMakePair(source, target);
+    }));
+
+    QCOMPARE(replayed.size(), 4);
+    QCOMPARE(replayed.mid(0, 3), log);
+    QCOMPARE(replayed.last(), qMakePair(QString("with\ttab\\"), QString("with\nnewline")));
+
+    QVERIFY(!FileJournal::replay("not-existed.txt", [](const QString&, const QString&) {}));
+
+    // The records could not be written
+    FileJournal broken("dir-not-existed/journal.txt");
+    QVERIFY(!broken.hasError());
+    broken.append("a", "b");
+    QVERIFY(broken.hasError());
+}
+
 void QtShellTests::test_pwd()
 {
 
@@ -451,6 +1365,94 @@ void QtShellTests::test_cat()
 
 }
 
+void QtShellTests::test_cat_bytes()
+{
+    QByteArray data("0123\0" "456789", 11);
+    QFile file("cat.bin");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(data);
+    file.close();
+
+    QCOMPARE(catBytes("cat.bin"), data);
+
+    {
+        MappedFile mapped("cat.bin");
+        QVERIFY(mapped.isValid());
+        QCOMPARE(mapped.size(), (qint64) data.size());
+        QVERIFY(mapped.constData() != 0);
+        QCOMPARE(mapped.bytes(), data);
+        QVERIFY(mapped.bytes().constData() == mapped.constData());
+    }
+
+    touch("empty.txt");
+    {
+        MappedFile mapped("empty.txt");
+        QVERIFY(mapped.isValid());
+        QCOMPARE(mapped.size(), (qint64) 0);
+        QVERIFY(mapped.bytes().isEmpty());
+    }
+    QCOMPARE(cat("empty.txt"), QString());
+
+    MappedFile missing("file-not-existed.txt");
+    QVERIFY(!missing.isValid());
+    QVERIFY(catBytes("file-not-existed.txt").isNull());
+
+    // A resource file
+    QCOMPARE(catBytes(":/extract/main.cpp"), cat(":/extract/main.cpp").toUtf8());
+    QVERIFY(!catBytes(":/extract/main.cpp").isEmpty());
+
+    rm("cat.bin");
+    rm("empty.txt");
+}
+
+void QtShellTests::test_cat_stream()
+{
+    QByteArray data;
+    for (int i = 0 ; i < 1000 ; i++) {
+        data.append(QString("line %1\n").arg(i).toUtf8());
+    }
+
+    QFile file("cat.txt");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(data);
+    file.close();
+
+    QByteArray content;
+    int chunks = 0;
+    int maxSize = 0;
+    QVERIFY(cat("cat.txt", [&](const QByteArray& chunk) {
+        maxSize = qMax(maxSize, chunk.size());
+        content.append(chunk);
+        chunks++;
+        return true;
+    }, 100));
+    QCOMPARE(content, data);
+    QCOMPARE(maxSize, 100);
+    QCOMPARE(chunks, (data.size() + 99) / 100);
+
+    // Stop by the callback
+    chunks = 0;
+    QVERIFY(cat("cat.txt", [&](const QByteArray&) {
+        chunks++;
+        return false;
+    }, 100));
+    QCOMPARE(chunks, 1);
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    QVERIFY(cat("cat.txt", &buffer));
+    QCOMPARE(buffer.data(), data);
+
+    QBuffer readOnly;
+    QVERIFY(!cat("cat.txt", &readOnly));
+
+    QVERIFY(!cat("file-not-existed.txt", [&](const QByteArray&) {
+        return true;
+    }));
+
+    rm("cat.txt");
+}
+
 void QtShellTests::test_mv()
 {
     QList<QPair<QString,QString> > log;
@@ -485,6 +1487,140 @@ void QtShellTests::test_mv()
 
 }
 
+// A writable directory on another file system than the current directory, e.g. a tmpfs. An empty string if none is found
+static QString otherFileSystem() {
+    QStringList candidates;
+    candidates << QDir::tempPath() << "/dev/shm" << "/tmp";
+#ifdef Q_OS_UNIX
+    candidates << QString("/run/user/%1").arg(::getuid());
+#endif
+
+    QString root = QStorageInfo(pwd()).rootPath();
+
+    foreach (QString candidate, candidates) {
+        QFileInfo info(candidate);
+        QStorageInfo storage(candidate);
+        if (info.isDir() && info.isWritable() && storage.isValid() && storage.rootPath() != root) {
+            return candidate;
+        }
+    }
+
+    return QString();
+}
+
+void QtShellTests::test_mv_batch()
+{
+    rm("-rf", "spool");
+    rm("-rf", "ready");
+    mkdir("spool");
+    mkdir("ready");
+
+    for (int i = 0 ; i < 100 ; i++) {
+        touch(QString("spool/%1.part").arg(i));
+    }
+    touch("spool/keep.txt");
+    touch("spool/.hidden.part");
+
+    QList<QPair<QString,QString> > log;
+    QVERIFY(mv("spool/*.part", "ready", log));
+    QCOMPARE(log.size(), 100);
+    QCOMPARE(log.first(), qMakePair(QString("spool/0.part"), QString("ready/0.part")));
+    QCOMPARE(find("ready", "*.part").size(), 100);
+    QVERIFY(QFile::exists("spool/keep.txt"));
+    QVERIFY(QFile::exists("spool/.hidden.part"));
+
+    // An existing target is not replaced
+    QFile file("spool/0.part");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("new");
+    file.close();
+    QVERIFY(!mv("spool/*.part", "ready"));
+    QVERIFY(QFile::exists("spool/0.part"));
+    QCOMPARE(cat("ready/0.part"), QString());
+
+    QVERIFY(!mv("spool/*.none", "ready"));
+
+    // Across file systems, existing targets are kept
+    QString base = otherFileSystem();
+    if (base.isEmpty()) {
+        QSKIP("No writable directory on another file system");
+    }
+
+    QString other = base + "/qtshell-mv-batch";
+    rm("-rf", other);
+    mkdir("-p", other + "/dir.part");
+    touch(other + "/dir.part/keep.txt");
+    QFile existing(other + "/0.part");
+    QVERIFY(existing.open(QIODevice::WriteOnly));
+    existing.write("old");
+    existing.close();
+
+    rm("-rf", "spool");
+    mkdir("-p", "spool/dir.part");
+    touch("spool/dir.part/new.txt");
+    touch("spool/0.part");
+    touch("spool/1.part");
+
+    QVERIFY(!mv("spool/*.part", other));
+    QCOMPARE(cat(other + "/0.part"), QString("old"));
+    QVERIFY(QFile::exists(other + "/dir.part/keep.txt"));
+    QVERIFY(!QFile::exists(other + "/dir.part/new.txt"));
+    QVERIFY(QFile::exists(other + "/1.part"));
+    QVERIFY(QFile::exists("spool/0.part"));
+    QVERIFY(QFile::exists("spool/dir.part/new.txt"));
+    QVERIFY(!QFile::exists("spool/1.part"));
+
+    rm("-rf", other);
+}
+
+void QtShellTests::test_mv_cross_device()
+{
+    // Need a directory on another file system
+    QString base = otherFileSystem();
+    if (base.isEmpty()) {
+        QSKIP("No writable directory on another file system. Mount a tmpfs on /dev/shm or TMPDIR to run it");
+    }
+    QString other = base + "/qtshell-mv-test";
+
+    rm("-rf", other);
+    rm("-rf", "src");
+    mkdir(other);
+    mkdir("-p", "src/1/sub");
+    touch("src/1/a.txt");
+    touch("src/1/.hidden");
+    QFile file("src/1/sub/b.txt");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("content");
+    file.close();
+    QFileInfo original("src/1/sub/b.txt");
+
+    QVERIFY(mv("src/1", other));
+    QVERIFY(!QFile::exists("src/1"));
+    QVERIFY(QFile::exists(other + "/1/a.txt"));
+    QVERIFY(QFile::exists(other + "/1/.hidden"));
+    QCOMPARE(cat(other + "/1/sub/b.txt"), QString("content"));
+    QCOMPARE(QFileInfo(other + "/1/sub/b.txt").lastModified(), original.lastModified());
+
+    QVERIFY(mv(other + "/1/a.txt", "src"));
+    QVERIFY(QFile::exists("src/a.txt"));
+    QVERIFY(!QFile::exists(other + "/1/a.txt"));
+
+    // An existing target is neither replaced nor removed
+    QFile source("src/b.txt");
+    QVERIFY(source.open(QIODevice::WriteOnly));
+    source.write("new");
+    source.close();
+    QFile existing(other + "/b.txt");
+    QVERIFY(existing.open(QIODevice::WriteOnly));
+    existing.write("old");
+    existing.close();
+    QVERIFY(!mv("src/b.txt", other + "/b.txt"));
+    QCOMPARE(cat(other + "/b.txt"), QString("old"));
+    QCOMPARE(cat("src/b.txt"), QString("new"));
+
+    rm("-rf", other);
+}
+
 void QtShellTests::test_realpath_strip()
 {
     QCOMPARE(QtShell::realpath_strip(QtShell::pwd()),  QtShell::pwd());
@@ -544,5 +1680,46 @@ void QtShellTests::test_which()
 #ifdef Q_OS_WIN32
     QCOMPARE(QtShell::which("ping").toLower(), QString("c:\\Windows\\System32\\PING.EXE").toLower());
 #endif
+
+#ifdef Q_OS_UNIX
+    QStringList found = QtShell::which(QStringList() << "sh" << "qtshell-program-not-existed" << "sh");
+    QCOMPARE(found, QStringList() << "/bin/sh" << "" << "/bin/sh");
+
+    QVERIFY(QtShell::which("-a", "sh").contains("/bin/sh"));
+
+    rm("-rf", "bin");
+    mkdir("bin");
+    QByteArray path = qgetenv("PATH");
+    qputenv("PATH", QFile::encodeName(QtShell::pwd() + "/bin:") + path);
+
+    // Not an executable
+    touch("bin/qtshell-tool");
+    QCOMPARE(QtShell::which("qtshell-tool"), QString());
+
+    // chmod does not change the directory, but the cached name is checked again
+    QFile file("bin/qtshell-tool");
+    QFile::Permissions permissions = file.permissions();
+    QVERIFY(file.setPermissions(permissions | QFile::ExeOwner));
+    QCOMPARE(QtShell::which("qtshell-tool"), QtShell::pwd() + "/bin/qtshell-tool");
+    QCOMPARE(QtShell::which("-a", "sh").first(), QtShell::which("sh"));
+
+    QVERIFY(file.setPermissions(permissions));
+    if (::access("bin/qtshell-tool", X_OK) != 0) {
+        // root could execute it anyway
+        QCOMPARE(QtShell::which("qtshell-tool"), QString());
+    }
+
+    QVERIFY(file.setPermissions(permissions | QFile::ExeOwner));
+    QCOMPARE(QtShell::which("qtshell-tool"), QtShell::pwd() + "/bin/qtshell-tool");
+
+    // A new file is found right after a lookup missed it
+    QCOMPARE(QtShell::which("qtshell-tool2"), QString());
+    QVERIFY(QFile::copy("bin/qtshell-tool", "bin/qtshell-tool2"));
+    QCOMPARE(QtShell::which("qtshell-tool2"), QtShell::pwd() + "/bin/qtshell-tool2");
+
+    qputenv("PATH", path);
+    QCOMPARE(QtShell::which("qtshell-tool"), QString());
+    rm("-rf", "bin");
+#endif
 }
 
@@ -32,12 +32,36 @@ private slots:
 
     void test_find_options();
 
+    void test_find_threads();
+
+    void test_find_visitor();
+
+    void test_find_sorted();
+
+    void test_find_result();
+
+    void test_find_predicates();
+
+    void test_findIndex();
+
+    void test_findAsync();
+
+    void test_globMatcher();
+
+    void test_globMatcher_data();
+
     void test_rmdir();
 
     void test_touch();
 
     void test_rm();
 
+    void test_rm_parallel();
+
+    void test_rm_preserved();
+
+    void test_rm_defer();
+
     void test_mkdir();
 
     void test_cp();
@@ -48,12 +72,36 @@ private slots:
 
     void test_cp_log();
 
+    void test_cp_content();
+
+    void test_cp_sparse();
+
+    void test_cp_link();
+
+    void test_cp_threads();
+
+    void test_cp_update();
+
+    void test_extract();
+
+    void test_progress();
+
+    void test_journal();
+
     void test_pwd();
 
     void test_cat();
 
+    void test_cat_bytes();
+
+    void test_cat_stream();
+
     void test_mv();
 
+    void test_mv_cross_device();
+
+    void test_mv_batch();
+
     void test_realpath_strip();
 
     void test_which();